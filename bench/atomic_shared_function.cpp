@@ -0,0 +1,101 @@
+// Copyright (C) 2021 Artem Komyshan
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ak/atomic_shared_function.hpp"
+
+#include "bench.hpp"
+
+namespace
+{
+
+/// std::atomic<std::shared_ptr> is C++20, the C++17 free functions are used.
+class atomic_shared_ptr_function
+{
+public:
+  template <typename Func>
+  void store(Func func)
+  {
+    std::atomic_store(&mFunc,
+                      std::make_shared<std::function<int(int)>>(func));
+  }
+
+  int operator()(int a) const
+  {
+    return (*std::atomic_load(&mFunc))(a);
+  }
+
+private:
+  std::shared_ptr<std::function<int(int)>> mFunc;
+};
+
+/// Measures calls of \c func by \c readers threads while a writer replaces
+/// the target every 100 microseconds.
+template <typename Function>
+void bench_readers(std::string const& name, std::size_t readers)
+{
+  auto const calls = std::max<std::size_t>(1000, bench_iterations / readers);
+
+  Function func;
+  func.store([](int a) { return a + 1; });
+
+  std::atomic<bool> stop{false};
+  std::thread writer([&func, &stop] {
+    auto generation = 0;
+    while (!stop.load(std::memory_order_relaxed))
+      {
+        func.store([generation](int a) { return a + generation; });
+        ++generation;
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+      }
+  });
+
+  std::vector<std::thread> threads;
+  auto const start = std::chrono::steady_clock::now();
+  for (std::size_t r = 0; r < readers; ++r)
+    threads.emplace_back([&func, calls] {
+      auto sum = 0;
+      for (auto i = calls; i > 0; --i)
+        sum += func(1);
+      do_not_optimize(sum);
+    });
+  for (auto& thread : threads)
+    thread.join();
+  auto const stop_time = std::chrono::steady_clock::now();
+
+  stop = true;
+  writer.join();
+
+  // wall time per call of one reader, flat when reads scale
+  report(name + "/" + std::to_string(readers),
+         std::chrono::duration<double, std::nano>(stop_time - start).count() /
+             static_cast<double>(calls));
+}
+
+} // namespace
+
+BENCH(atomic_shared_function_readers)
+{
+  auto const cores = std::max(1u, std::thread::hardware_concurrency());
+  for (std::size_t readers = 1;;
+       readers = std::min<std::size_t>(readers * 2, cores))
+    {
+      bench_readers<ak::atomic_shared_function<int(int)>>(
+          "atomic_shared_function", readers);
+      bench_readers<atomic_shared_ptr_function>("atomic shared_ptr", readers);
+      if (readers == cores)
+        break;
+    }
+};
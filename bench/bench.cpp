@@ -0,0 +1,122 @@
+// Copyright (C) 2020 Artem Komyshan
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include "bench.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "atomic_shared_function.cpp"
+#include "call_on_expire.cpp"
+#include "call_once_strict.cpp"
+#include "callback_collection.cpp"
+#include "join_counter.cpp"
+#include "not_empty_function.cpp"
+#include "oneshot.cpp"
+#include "shared_function.cpp"
+#include "suite.cpp"
+#include "task_queue.cpp"
+#include "thread_pool.cpp"
+
+namespace
+{
+
+std::string json_escape(std::string const& text)
+{
+  std::string escaped;
+  for (auto c : text)
+    {
+      if (c == '"' || c == '\\')
+        escaped += '\\';
+      else if (static_cast<unsigned char>(c) < 0x20)
+        {
+          char code[7];
+          std::snprintf(code, sizeof(code), "\\u%04x", c);
+          escaped += code;
+          continue;
+        }
+      escaped += c;
+    }
+  return escaped;
+}
+
+void print_json()
+{
+  std::cout << "{\n  \"iterations\": " << bench_iterations
+            << ",\n  \"results\": [";
+  auto first = true;
+  for (auto& result : bench_results)
+    {
+      std::cout << (first ? "\n" : ",\n") << "    {\"group\": \""
+                << json_escape(result.group) << "\", \"name\": \""
+                << json_escape(result.name)
+                << "\", \"ns_per_op\": " << result.ns << "}";
+      first = false;
+    }
+  std::cout << "\n  ]\n}" << std::endl;
+}
+
+} // namespace
+
+/**
+ * Usage: bench_functions [--json] [--filter <text>] [--iterations <n>]
+ *   --json        print the results as JSON instead of text
+ *   --filter      run only the benchmarks whose name contains <text>
+ *   --iterations  number of measured runs of every operation, at least 1
+ */
+int main(int argc, char** argv)
+{
+  std::string filter;
+  for (auto i = 1; i < argc; ++i)
+    {
+      std::string const arg = argv[i];
+      if (arg == "--json")
+        bench_json = true;
+      else if (arg == "--filter" && i + 1 < argc)
+        filter = argv[++i];
+      else if (arg == "--iterations" && i + 1 < argc)
+        {
+          char* end = nullptr;
+          auto const value = std::strtol(argv[++i], &end, 10);
+          if (*end != '\0' || value < 1)
+            {
+              std::cerr << "Invalid --iterations: " << argv[i] << std::endl;
+              return 1;
+            }
+          bench_iterations = static_cast<std::size_t>(value);
+        }
+      else
+        {
+          std::cerr << "Unknown argument: " << arg << std::endl;
+          return 1;
+        }
+    }
+
+  // libstdc++ skips atomic operations until the first thread is started,
+  // measure what a multi-threaded program pays
+  std::thread([] {}).join();
+
+  if (!bench_json)
+    std::cout << "BENCH number: " << benchmarks.size() << std::endl;
+  for (auto& bench : benchmarks)
+    {
+      if (bench.first.find(filter) == std::string::npos)
+        continue;
+
+      bench_group = bench.first;
+      if (!bench_json)
+        std::cout << bench.first << std::endl;
+      bench.second();
+    }
+
+  if (bench_json)
+    print_json();
+
+  return 0;
+}
@@ -0,0 +1,115 @@
+// Copyright (C) 2020 Artem Komyshan
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+std::vector<std::pair<std::string, std::function<void()>>> benchmarks;
+
+struct bench_result
+{
+  std::string group;
+  std::string name;
+  double ns;
+};
+
+/// Filled by report(), printed as JSON by main() when --json is given.
+std::vector<bench_result> bench_results;
+std::string bench_group;
+bool bench_json = false;
+
+std::size_t bench_iterations = 1000000;
+
+/// Prevents the compiler from optimizing away the computation of \c value.
+template <typename T>
+inline void do_not_optimize(T const& value)
+{
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+/// Records a result of the running benchmark, \c ns is nanoseconds per op.
+inline void report(std::string const& name, double ns)
+{
+  bench_results.push_back({bench_group, name, ns});
+  if (!bench_json)
+    std::cout << "  " << name << ": " << ns << " ns/op" << std::endl;
+}
+
+/**
+ * @brief measure runs \c op \c iterations times after a short warm up and
+ * reports the average duration of one run. Scaled down counts are rounded up
+ * to a single run.
+ */
+template <typename Func>
+double measure(std::string const& name, Func&& op,
+               std::size_t iterations = bench_iterations)
+{
+  iterations = std::max<std::size_t>(1, iterations);
+  for (auto i = iterations / 10; i > 0; --i)
+    op();
+
+  auto const start = std::chrono::steady_clock::now();
+  for (auto i = iterations; i > 0; --i)
+    op();
+  auto const stop = std::chrono::steady_clock::now();
+
+  auto const ns =
+      std::chrono::duration<double, std::nano>(stop - start).count() /
+      static_cast<double>(iterations);
+  report(name, ns);
+  return ns;
+}
+
+/**
+ * @brief measure_batch runs \c setup untimed and then \c op on the prepared
+ * state, \c batch is the number of operations done by one \c op run.
+ */
+template <typename Setup, typename Func>
+double measure_batch(std::string const& name, Setup&& setup, Func&& op,
+                     std::size_t batch)
+{
+  auto const rounds = std::max<std::size_t>(1, bench_iterations / batch);
+  std::chrono::steady_clock::duration total{};
+  for (auto i = rounds; i > 0; --i)
+    {
+      setup();
+      auto const start = std::chrono::steady_clock::now();
+      op();
+      total += std::chrono::steady_clock::now() - start;
+    }
+
+  auto const ns = std::chrono::duration<double, std::nano>(total).count() /
+                  static_cast<double>(rounds * batch);
+  report(name, ns);
+  return ns;
+}
+
+struct bench_t
+{
+  bench_t(std::string _name) : name(_name) {}
+
+  std::string name;
+
+  template <typename Func>
+  bench_t& operator<<(Func&& func)
+  {
+    benchmarks.emplace_back(name, std::forward<Func>(func));
+    return *this;
+  }
+};
+
+#define STRINGIFY_(x) #x
+#define STRINGIFY(x) STRINGIFY_(x)
+
+#define BENCH(NAME) auto NAME = bench_t{STRINGIFY(NAME)} << []
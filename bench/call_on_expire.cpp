@@ -0,0 +1,66 @@
+// Copyright (C) 2020 Artem Komyshan
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "ak/call_on_expire.hpp"
+#include "ak/executor.hpp"
+#include "ak/thread_pool.hpp"
+
+#include "bench.hpp"
+
+using namespace ak;
+
+namespace
+{
+
+void busy_wait(std::chrono::microseconds duration)
+{
+  auto const stop = std::chrono::steady_clock::now() + duration;
+  while (std::chrono::steady_clock::now() < stop)
+    {
+    }
+}
+
+/// Measures how long the thread dropping the last copy is blocked.
+template <typename Executor>
+void bench_release_latency(std::string const& name, Executor& executor)
+{
+  constexpr auto samples = 2000;
+  std::vector<double> latencies;
+  latencies.reserve(samples);
+
+  for (auto i = 0; i < samples; ++i)
+    {
+      call_on_expire coe{executor, [] {
+                           busy_wait(std::chrono::microseconds(20));
+                         }};
+
+      auto const start = std::chrono::steady_clock::now();
+      coe.release();
+      auto const stop = std::chrono::steady_clock::now();
+      latencies.push_back(
+          std::chrono::duration<double, std::nano>(stop - start).count());
+    }
+
+  std::sort(latencies.begin(), latencies.end());
+  report(name + " p50", latencies[samples / 2]);
+  report(name + " p99", latencies[samples * 99 / 100]);
+  report(name + " max", latencies.back());
+}
+
+} // namespace
+
+BENCH(call_on_expire_release_latency)
+{
+  inline_executor inline_exec;
+  bench_release_latency("inline_executor", inline_exec);
+
+  thread_pool pool(1);
+  bench_release_latency("thread_pool", pool);
+};
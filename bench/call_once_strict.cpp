@@ -0,0 +1,80 @@
+// Copyright (C) 2020 Artem Komyshan
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <atomic>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "ak/call_once_strict.hpp"
+
+#include "bench.hpp"
+
+using namespace ak;
+
+namespace
+{
+
+/// The mutex based wrapper call_once_strict is compared with.
+template <typename Func>
+class locked_call_once
+{
+public:
+  explicit locked_call_once(Func func) : mFunc(std::move(func)) {}
+
+  void operator()()
+  {
+    std::optional<Func> func;
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      func.swap(mFunc);
+    }
+    if (func)
+      (*func)();
+  }
+
+private:
+  std::mutex mMutex;
+  std::optional<Func> mFunc;
+};
+
+/// Every thread calls the same object \c calls times, one call wins.
+template <typename Call>
+void bench_contention(std::string const& name, std::size_t threads)
+{
+  constexpr std::size_t calls = 100000;
+  std::atomic<int> winners{0};
+  Call call{[&winners] { ++winners; }};
+
+  measure(
+      name + " x" + std::to_string(threads),
+      [&] {
+        std::vector<std::thread> workers;
+        for (auto i = threads; i > 0; --i)
+          workers.emplace_back([&call] {
+            for (auto j = calls; j > 0; --j)
+              call();
+          });
+        for (auto& worker : workers)
+          worker.join();
+      },
+      10);
+}
+
+} // namespace
+
+BENCH(call_once_strict_contention)
+{
+  using target_t = std::function<void()>;
+
+  for (std::size_t threads : {1, 2, 4, 8})
+    {
+      bench_contention<call_once_strict<target_t, ignore_repeat>>(
+          "call_once_strict", threads);
+      bench_contention<locked_call_once<target_t>>("mutex", threads);
+    }
+};
@@ -0,0 +1,86 @@
+// Copyright (C) 2021 Artem Komyshan
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <cstddef>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ak/callback_collection.hpp"
+#include "ak/not_empty_function.hpp"
+
+#include "bench.hpp"
+
+namespace
+{
+
+template <int N>
+struct handler
+{
+  void operator()(int& sum) const
+  {
+    sum += N * factor;
+  }
+
+  int factor;
+};
+
+using handler_function = ak::not_empty_function<void(int&)>;
+
+template <typename Add, int... N>
+void add_kind(int kind, Add& add, std::integer_sequence<int, N...>)
+{
+  ((kind == N ? add(handler<N>{1}) : void()), ...);
+}
+
+/// Appends handlers of randomly chosen types, the types are interleaved.
+template <typename Add>
+void add_mixed(std::size_t count, Add add)
+{
+  std::mt19937 random(42);
+  std::uniform_int_distribution<int> kind(0, 7);
+  for (std::size_t i = 0; i < count; ++i)
+    add_kind(kind(random), add, std::make_integer_sequence<int, 8>());
+}
+
+void bench_emit(std::size_t count)
+{
+  auto const suffix = "/" + std::to_string(count);
+
+  std::vector<handler_function> functions;
+  add_mixed(count, [&functions](auto h) { functions.emplace_back(h); });
+
+  ak::callback_collection<void(int&)> collection;
+  add_mixed(count, [&collection](auto h) { collection.insert(h); });
+
+  measure_batch(
+      "vector<not_empty_function>" + suffix, [] {},
+      [&functions] {
+        auto sum = 0;
+        for (auto& f : functions)
+          f(sum);
+        do_not_optimize(sum);
+      },
+      count);
+
+  measure_batch(
+      "callback_collection" + suffix, [] {},
+      [&collection] {
+        auto sum = 0;
+        collection(sum);
+        do_not_optimize(sum);
+      },
+      count);
+}
+
+} // namespace
+
+BENCH(callback_collection_emit)
+{
+  bench_emit(100);
+  bench_emit(10000);
+};
@@ -0,0 +1,114 @@
+// Copyright (C) 2021 Artem Komyshan
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ak/call_on_expire.hpp"
+#include "ak/join_counter.hpp"
+#include "ak/thread_pool.hpp"
+
+#include "bench.hpp"
+
+using namespace ak;
+
+namespace
+{
+
+/// The fan-in built from call_on_expire: the results live in a shared
+/// vector, every sub-task keeps a copy of the call_on_expire.
+void run_call_on_expire(std::size_t count)
+{
+  auto results = std::make_shared<std::vector<int>>(count);
+  call_on_expire coe{[results] { do_not_optimize(results->back()); }};
+
+  for (std::size_t i = 0; i < count; ++i)
+    {
+      auto task = [coe, results, i] { (*results)[i] = static_cast<int>(i); };
+      task();
+    }
+}
+
+void run_join_counter(std::size_t count)
+{
+  join_counter<int> join(count, [](join_results<int> results) {
+    do_not_optimize(*results[results.size() - 1]);
+  });
+
+  for (std::size_t i = 0; i < count; ++i)
+    {
+      auto task = [completion = join.make_completion(), i]() mutable {
+        completion(static_cast<int>(i));
+      };
+      task();
+    }
+}
+
+void post_call_on_expire(thread_pool& pool, std::size_t count,
+                         std::atomic<bool>& done)
+{
+  auto results = std::make_shared<std::vector<int>>(count);
+  call_on_expire coe{
+      [&done] { done.store(true, std::memory_order_release); }};
+
+  for (std::size_t i = 0; i < count; ++i)
+    pool.post([coe, results, i] { (*results)[i] = static_cast<int>(i); });
+}
+
+void post_join_counter(thread_pool& pool, std::size_t count,
+                       std::atomic<bool>& done)
+{
+  join_counter<int> join(count, [&done](join_results<int>) {
+    done.store(true, std::memory_order_release);
+  });
+
+  for (std::size_t i = 0; i < count; ++i)
+    pool.post([completion = join.make_completion(), i]() mutable {
+      completion(static_cast<int>(i));
+    });
+}
+
+/// The sub-tasks complete on the workers of \c pool, measures one fan-in.
+template <typename Post>
+void bench_pool_fan_in(std::string const& name, thread_pool& pool,
+                       std::size_t count, Post post)
+{
+  measure(
+      name + "/" + std::to_string(count),
+      [&pool, count, post] {
+        std::atomic<bool> done{false};
+        post(pool, count, done);
+        while (!done.load(std::memory_order_acquire))
+          std::this_thread::yield();
+      },
+      bench_iterations / count / 10);
+}
+
+} // namespace
+
+BENCH(join_counter_fan_in)
+{
+  for (std::size_t count : {4, 16, 64})
+    {
+      auto const suffix = "/" + std::to_string(count);
+      auto const iterations = bench_iterations / count;
+      measure("call_on_expire" + suffix,
+              [count] { run_call_on_expire(count); }, iterations);
+      measure("join_counter" + suffix, [count] { run_join_counter(count); },
+              iterations);
+    }
+};
+
+BENCH(join_counter_thread_pool_fan_in)
+{
+  thread_pool pool;
+  bench_pool_fan_in("call_on_expire", pool, 16, &post_call_on_expire);
+  bench_pool_fan_in("join_counter", pool, 16, &post_join_counter);
+};
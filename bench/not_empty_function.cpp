@@ -0,0 +1,88 @@
+// Copyright (C) 2020 Artem Komyshan
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <array>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "ak/not_empty_function.hpp"
+
+#include "bench.hpp"
+
+using namespace ak;
+
+namespace
+{
+
+template <typename Function>
+void bench_move(std::string const& name, Function f)
+{
+  measure(name, [&f] {
+    Function tmp = std::move(f);
+    f = std::move(tmp);
+    do_not_optimize(f);
+  });
+}
+
+template <typename Function>
+void bench_copy(std::string const& name, Function f)
+{
+  measure(name, [&f] {
+    Function tmp = f;
+    do_not_optimize(tmp);
+  });
+}
+
+} // namespace
+
+BENCH(not_empty_function_move)
+{
+  int* a = nullptr;
+  int* b = nullptr;
+  measure("pointer swap", [&a, &b] {
+    std::swap(a, b);
+    do_not_optimize(a);
+  });
+
+  auto shared = std::make_shared<int>(0);
+  std::array<char, 256> big{};
+
+  bench_move("move unique_ptr", std::make_unique<int>(0));
+  bench_move("move std::function heap",
+             std::function<int()>([big] { return big[0]; }));
+
+  bench_move("move inline trivial",
+             not_empty_function<int()>([p = shared.get()] { return *p; }));
+  bench_move("move inline shared_ptr",
+             not_empty_function<int()>([shared] { return *shared; }));
+  bench_move("move heap",
+             not_empty_function<int()>([big] { return big[0]; }));
+
+  bench_copy("copy inline shared_ptr",
+             not_empty_function<int()>([shared] { return *shared; }));
+  bench_copy("copy heap", not_empty_function<int()>([big] { return big[0]; }));
+};
+
+BENCH(not_empty_function_vector_relocation)
+{
+  std::array<char, 256> big{};
+  std::vector<not_empty_function<int()>> functions(
+      1000, not_empty_function<int()>([big] { return big[0]; }));
+
+  measure(
+      "relocate 1000 heap targets",
+      [&functions] {
+        std::vector<not_empty_function<int()>> relocated;
+        relocated.reserve(functions.size());
+        for (auto& f : functions)
+          relocated.push_back(std::move(f));
+        functions.swap(relocated);
+        do_not_optimize(functions.data());
+      },
+      1000);
+};
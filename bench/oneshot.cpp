@@ -0,0 +1,63 @@
+// Copyright (C) 2021 Artem Komyshan
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <future>
+#include <optional>
+#include <utility>
+
+#include "ak/oneshot.hpp"
+#include "ak/thread_pool.hpp"
+
+#include "bench.hpp"
+
+using namespace ak;
+
+BENCH(oneshot_same_thread)
+{
+  measure("std::promise", [] {
+    std::promise<int> promise;
+    auto future = promise.get_future();
+    promise.set_value(1);
+    do_not_optimize(future.get());
+  });
+
+  measure("oneshot wait", [] {
+    auto [sender, receiver] = oneshot<int>();
+    sender(1);
+    do_not_optimize(*receiver.wait());
+  });
+
+  measure("oneshot then", [] {
+    auto [sender, receiver] = oneshot<int>();
+    receiver.then([](std::optional<int> r) { do_not_optimize(*r); });
+    sender(1);
+  });
+};
+
+BENCH(oneshot_thread_pool_round_trip)
+{
+  thread_pool pool(1);
+  auto const iterations = bench_iterations / 10;
+
+  measure(
+      "std::promise",
+      [&pool] {
+        std::promise<int> promise;
+        auto future = promise.get_future();
+        pool.post([p = std::move(promise)]() mutable { p.set_value(1); });
+        do_not_optimize(future.get());
+      },
+      iterations);
+
+  measure(
+      "oneshot",
+      [&pool] {
+        auto [sender, receiver] = oneshot<int>();
+        pool.post([s = std::move(sender)]() mutable { s(1); });
+        do_not_optimize(*receiver.wait());
+      },
+      iterations);
+};
@@ -0,0 +1,125 @@
+// Copyright (C) 2020 Artem Komyshan
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ak/shared_function.hpp"
+
+#include "bench.hpp"
+
+using namespace ak;
+
+namespace
+{
+
+template <typename Function>
+void bench_copy_destroy(std::string const& name, Function const& f)
+{
+  measure(name, [&f] {
+    Function copy = f;
+    do_not_optimize(copy);
+  });
+}
+
+template <typename Function>
+double copy_destroy_loop(Function const& f, std::size_t iterations)
+{
+  auto const start = std::chrono::steady_clock::now();
+  for (auto i = iterations; i > 0; --i)
+    {
+      Function copy = f;
+      do_not_optimize(copy);
+    }
+  return std::chrono::duration<double, std::nano>(
+             std::chrono::steady_clock::now() - start)
+             .count() /
+         static_cast<double>(iterations);
+}
+
+/// The calling thread makes the function and copies it along with
+/// \c threads - 1 other threads, the owner and the others are reported apart.
+template <typename Function, typename Target>
+void bench_contended(std::string const& name, Target const& target,
+                     std::size_t threads)
+{
+  Function const f = target;
+  std::atomic<bool> go{false};
+  std::vector<double> others(threads - 1);
+
+  std::vector<std::thread> workers;
+  for (std::size_t t = 0; t + 1 < threads; ++t)
+    workers.emplace_back([&f, &go, &others, t] {
+      while (!go.load(std::memory_order_acquire))
+        std::this_thread::yield();
+      others[t] = copy_destroy_loop(f, bench_iterations);
+    });
+
+  go.store(true, std::memory_order_release);
+  auto const owner = copy_destroy_loop(f, bench_iterations);
+  for (auto& worker : workers)
+    worker.join();
+
+  auto const suffix = "/" + std::to_string(threads);
+  report(name + " owner" + suffix, owner);
+  if (!others.empty())
+    report(name + " others" + suffix,
+           *std::max_element(others.begin(), others.end()));
+}
+
+} // namespace
+
+BENCH(shared_function_contended_copy)
+{
+  auto value = 0;
+  auto target = [&value](int a) { return value += a; };
+
+  auto const cores = std::max(1u, std::thread::hardware_concurrency());
+  for (std::size_t threads = 1;;
+       threads = std::min<std::size_t>(threads * 2, cores))
+    {
+      bench_contended<shared_function<int(int)>>("shared_function", target,
+                                                 threads);
+      bench_contended<biased_shared_function<int(int)>>(
+          "biased_shared_function", target, threads);
+      if (threads == cores)
+        break;
+    }
+};
+
+BENCH(shared_function_copy_destroy)
+{
+  auto value = 0;
+  auto target = [&value](int a) { return value += a; };
+
+  bench_copy_destroy(
+      "shared_ptr<std::function>",
+      std::make_shared<std::function<int(int)>>(target));
+  bench_copy_destroy("shared_function", shared_function<int(int)>(target));
+  bench_copy_destroy("local_shared_function",
+                     local_shared_function<int(int)>(target));
+  bench_copy_destroy("biased_shared_function",
+                     biased_shared_function<int(int)>(target));
+};
+
+BENCH(shared_function_invoke)
+{
+  auto value = 0;
+  auto target = [&value](int a) { return value += a; };
+
+  auto sp = std::make_shared<std::function<int(int)>>(target);
+  measure("shared_ptr<std::function>", [&sp] { do_not_optimize((*sp)(1)); });
+
+  shared_function<int(int)> sf = target;
+  measure("shared_function", [&sf] { do_not_optimize(sf(1)); });
+};
@@ -0,0 +1,262 @@
+// Copyright (C) 2020 Artem Komyshan
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "ak/call_on_expire.hpp"
+#include "ak/call_once_silent.hpp"
+#include "ak/callback_guardian.hpp"
+#include "ak/not_empty_function.hpp"
+#include "ak/shared_function.hpp"
+
+#include "bench.hpp"
+
+/**
+ * The suite measures construction, copy, move, invoke and destruction of every
+ * wrapper against std::function and the raw lambda, sweeping the size of the
+ * captured state. Result names are <wrapper>/<operation>/<capture bytes>.
+ */
+
+namespace suite
+{
+
+using namespace ak;
+
+template <std::size_t Size>
+auto make_target()
+{
+  if constexpr (Size == 0)
+    return [](int a) { return a + 1; };
+  else
+    return [data = std::array<char, Size>{}](int a) { return a + data[0]; };
+}
+
+template <typename Wrapper>
+void invoke(Wrapper& wrapper)
+{
+  if constexpr (std::is_void<std::invoke_result_t<Wrapper&, int>>::value)
+    {
+      wrapper(1);
+      do_not_optimize(wrapper);
+    }
+  else
+    do_not_optimize(wrapper(1));
+}
+
+template <typename Wrapper>
+struct is_one_shot : std::false_type
+{
+};
+
+template <typename... Args>
+struct is_one_shot<call_once_silent<Args...>> : std::true_type
+{
+};
+
+/// \c make returns a new wrapper around the target of \c Size bytes.
+template <std::size_t Size, typename Make>
+void bench_wrapper(std::string const& wrapper, Make make)
+{
+  using wrapper_t = decltype(make());
+  auto const name = [&wrapper](char const* op) {
+    return wrapper + "/" + op + "/" + std::to_string(Size);
+  };
+
+  measure(name("construct"), [&make] {
+    wrapper_t w = make();
+    do_not_optimize(w);
+  });
+
+  if constexpr (std::is_copy_constructible<wrapper_t>::value)
+    {
+      wrapper_t w = make();
+      measure(name("copy"), [&w] {
+        wrapper_t copy = w;
+        do_not_optimize(copy);
+      });
+    }
+
+  if constexpr (std::is_move_assignable<wrapper_t>::value)
+    {
+      wrapper_t w = make();
+      measure(name("move"), [&w] {
+        wrapper_t tmp = std::move(w);
+        w = std::move(tmp);
+        do_not_optimize(w);
+      });
+    }
+  else
+    {
+      measure(name("move"), [&make] {
+        wrapper_t w = make();
+        wrapper_t moved = std::move(w);
+        do_not_optimize(moved);
+      });
+    }
+
+  if constexpr (is_one_shot<wrapper_t>::value)
+    {
+      measure(name("construct+invoke"), [&make] {
+        wrapper_t w = make();
+        invoke(w);
+      });
+    }
+  else if constexpr (std::is_invocable<wrapper_t&, int>::value)
+    {
+      wrapper_t w = make();
+      measure(name("invoke"), [&w] { invoke(w); });
+    }
+
+  constexpr std::size_t batch = 1000;
+  std::vector<wrapper_t> pool;
+  measure_batch(
+      name("destroy"),
+      [&pool, &make] {
+        pool.clear();
+        pool.reserve(batch);
+        for (auto i = batch; i > 0; --i)
+          pool.push_back(make());
+      },
+      [&pool] { pool.clear(); }, batch);
+}
+
+template <template <std::size_t> class Bench>
+void sweep_capture_size()
+{
+  Bench<0>::run();
+  Bench<8>::run();
+  Bench<16>::run();
+  Bench<32>::run();
+  Bench<64>::run();
+  Bench<128>::run();
+  Bench<256>::run();
+}
+
+template <std::size_t Size>
+struct lambda_bench
+{
+  static void run()
+  {
+    auto const target = make_target<Size>();
+    bench_wrapper<Size>("lambda", [&target] { return target; });
+  }
+};
+
+template <std::size_t Size>
+struct std_function_bench
+{
+  static void run()
+  {
+    auto const target = make_target<Size>();
+    bench_wrapper<Size>("std::function", [&target] {
+      return std::function<int(int)>(target);
+    });
+  }
+};
+
+template <std::size_t Size>
+struct not_empty_function_bench
+{
+  static void run()
+  {
+    auto const target = make_target<Size>();
+    bench_wrapper<Size>("not_empty_function", [&target] {
+      return not_empty_function<int(int)>(target);
+    });
+  }
+};
+
+template <std::size_t Size>
+struct shared_function_bench
+{
+  static void run()
+  {
+    auto const target = make_target<Size>();
+    bench_wrapper<Size>("shared_function", [&target] {
+      return shared_function<int(int)>(target);
+    });
+  }
+};
+
+template <std::size_t Size>
+struct call_once_silent_bench
+{
+  static void run()
+  {
+    auto const target = make_target<Size>();
+    bench_wrapper<Size>("call_once_silent", [&target] {
+      return call_once_silent<int>(target);
+    });
+  }
+};
+
+template <std::size_t Size>
+struct call_on_expire_bench
+{
+  static void run()
+  {
+    auto const target = make_target<Size>();
+    auto const action = [target] { do_not_optimize(target(1)); };
+    bench_wrapper<Size>("call_on_expire",
+                        [&action] { return call_on_expire(action); });
+  }
+};
+
+template <std::size_t Size>
+struct guarded_callback_bench
+{
+  static void run()
+  {
+    auto const target = make_target<Size>();
+    callback_guardian guardian;
+    bench_wrapper<Size>("guarded_callback", [&target, &guardian] {
+      return guardian.make_guarded_callback(target);
+    });
+  }
+};
+
+} // namespace suite
+
+BENCH(suite_lambda)
+{
+  suite::sweep_capture_size<suite::lambda_bench>();
+};
+
+BENCH(suite_std_function)
+{
+  suite::sweep_capture_size<suite::std_function_bench>();
+};
+
+BENCH(suite_not_empty_function)
+{
+  suite::sweep_capture_size<suite::not_empty_function_bench>();
+};
+
+BENCH(suite_shared_function)
+{
+  suite::sweep_capture_size<suite::shared_function_bench>();
+};
+
+BENCH(suite_call_once_silent)
+{
+  suite::sweep_capture_size<suite::call_once_silent_bench>();
+};
+
+BENCH(suite_call_on_expire)
+{
+  suite::sweep_capture_size<suite::call_on_expire_bench>();
+};
+
+BENCH(suite_guarded_callback)
+{
+  suite::sweep_capture_size<suite::guarded_callback_bench>();
+};
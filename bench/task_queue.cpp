@@ -0,0 +1,100 @@
+// Copyright (C) 2021 Artem Komyshan
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ak/call_once_silent.hpp"
+#include "ak/task_queue.hpp"
+
+#include "bench.hpp"
+
+namespace
+{
+
+/// The mutex protected deque the task_queue replaces.
+class locked_queue
+{
+public:
+  template <typename Func>
+  void post(Func&& func)
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mTasks.emplace_back(std::forward<Func>(func));
+  }
+
+  std::size_t drain()
+  {
+    std::deque<ak::call_once_silent<>> tasks;
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      tasks.swap(mTasks);
+    }
+    for (auto& task : tasks)
+      task();
+    return tasks.size();
+  }
+
+private:
+  std::mutex mMutex;
+  std::deque<ak::call_once_silent<>> mTasks;
+};
+
+/// Measures the time to push and run \c tasks split between \c producers.
+template <typename Queue>
+void bench_throughput(std::string const& name, std::size_t producers)
+{
+  auto const tasks = std::max<std::size_t>(producers, bench_iterations / 10);
+  auto const per_producer = tasks / producers;
+  auto const total = per_producer * producers;
+
+  Queue queue;
+  std::size_t sum = 0;
+  std::atomic<bool> go{false};
+
+  std::vector<std::thread> threads;
+  for (std::size_t p = 0; p < producers; ++p)
+    threads.emplace_back([&queue, &sum, &go, per_producer] {
+      while (!go.load(std::memory_order_acquire))
+        std::this_thread::yield();
+      for (auto i = per_producer; i > 0; --i)
+        queue.post([&sum] { ++sum; });
+    });
+
+  auto const start = std::chrono::steady_clock::now();
+  go.store(true, std::memory_order_release);
+  std::size_t done = 0;
+  while (done < total)
+    done += queue.drain();
+  auto const stop = std::chrono::steady_clock::now();
+
+  for (auto& thread : threads)
+    thread.join();
+
+  do_not_optimize(sum);
+  report(name + "/" + std::to_string(producers),
+         std::chrono::duration<double, std::nano>(stop - start).count() /
+             static_cast<double>(total));
+}
+
+} // namespace
+
+BENCH(task_queue_throughput)
+{
+  auto const cores = std::max(2u, std::thread::hardware_concurrency());
+  for (std::size_t producers = 1; producers <= cores; producers *= 2)
+    {
+      bench_throughput<ak::task_queue>("task_queue", producers);
+      bench_throughput<locked_queue>("mutex+deque", producers);
+    }
+};
@@ -0,0 +1,87 @@
+// Copyright (C) 2021 Artem Komyshan
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <thread>
+
+#include "ak/thread_pool.hpp"
+
+#include "bench.hpp"
+
+namespace
+{
+
+void spin(unsigned rounds)
+{
+  auto volatile sink = 0u;
+  for (auto i = rounds; i > 0; --i)
+    sink = sink + i;
+}
+
+/// Measures the time per task to run \c tasks posted from outside the pool.
+void bench_scaling(std::size_t threads)
+{
+  auto const tasks = std::max<std::size_t>(1000, bench_iterations / 10);
+  std::atomic<std::size_t> done{0};
+
+  ak::thread_pool pool(threads);
+  auto const start = std::chrono::steady_clock::now();
+  for (auto i = tasks; i > 0; --i)
+    pool.post([&done] {
+      spin(100);
+      done.fetch_add(1, std::memory_order_relaxed);
+    });
+  while (done.load(std::memory_order_acquire) < tasks)
+    std::this_thread::yield();
+  auto const stop = std::chrono::steady_clock::now();
+
+  report("thread_pool post/" + std::to_string(threads),
+         std::chrono::duration<double, std::nano>(stop - start).count() /
+             static_cast<double>(tasks));
+}
+
+/// One worker fans the tasks out, the others have to steal them.
+void bench_fan_out(std::size_t threads)
+{
+  auto const tasks = std::max<std::size_t>(1000, bench_iterations / 10);
+  std::atomic<std::size_t> done{0};
+
+  ak::thread_pool pool(threads);
+  auto const start = std::chrono::steady_clock::now();
+  pool.post([&pool, &done, tasks] {
+    for (auto i = tasks; i > 0; --i)
+      pool.defer([&done] {
+        spin(100);
+        done.fetch_add(1, std::memory_order_relaxed);
+      });
+  });
+  while (done.load(std::memory_order_acquire) < tasks)
+    std::this_thread::yield();
+  auto const stop = std::chrono::steady_clock::now();
+
+  report("thread_pool defer fan-out/" + std::to_string(threads),
+         std::chrono::duration<double, std::nano>(stop - start).count() /
+             static_cast<double>(tasks));
+}
+
+} // namespace
+
+BENCH(thread_pool_scaling)
+{
+  auto const cores = std::max(1u, std::thread::hardware_concurrency());
+  for (std::size_t threads = 1;; threads = std::min<std::size_t>(
+                                     threads * 2, cores))
+    {
+      bench_scaling(threads);
+      bench_fan_out(threads);
+      if (threads == cores)
+        break;
+    }
+};
@@ -0,0 +1,211 @@
+// Copyright (C) 2021 Artem Komyshan
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "ak/detail/hazard_pointer.hpp"
+#include "ak/requires.hpp"
+#include "ak/shared_function.hpp"
+
+/**
+ * @brief atomic_shared_function is a shared_function which may be replaced
+ * while other threads call it, e.g. a routing handler reloaded at runtime.
+ *
+ * A call does not lock and does not touch the reference counter: the calling
+ * thread publishes a hazard pointer to the current target, which keeps the
+ * target alive until the call returns. store() publishes the new target with
+ * a single atomic exchange, the replaced targets are destroyed by later
+ * store() or collect() calls once no thread is calling them anymore, never
+ * on the calling threads.
+ *
+ * ak::atomic_shared_function<void(Request&)> route = handle_v1;
+ * // any thread
+ * route(request);
+ * // reload
+ * route.store(handle_v2);
+ *
+ * Calls may nest, e.g. a handler calling itself. Nesting deeper than
+ * detail::hazard_slots::count on a thread allocates more hazard slots the
+ * first time it happens.
+ */
+
+namespace ak
+{
+
+template <typename Signature>
+class atomic_shared_function;
+
+template <typename Ret, typename... Args>
+class atomic_shared_function<Ret(Args...)>
+{
+  using target_t = shared_function<Ret(Args...)>;
+
+public:
+  atomic_shared_function() noexcept = default;
+
+  atomic_shared_function(target_t func);
+
+  template <typename Func,
+            typename = Requires<Not<std::is_same<
+                typename std::decay<Func>::type, atomic_shared_function>>>,
+            typename = Requires<std::is_constructible<target_t, Func>>>
+  atomic_shared_function(Func&& func)
+      : atomic_shared_function(target_t(std::forward<Func>(func)))
+  {
+  }
+
+  atomic_shared_function(atomic_shared_function const&) = delete;
+  atomic_shared_function& operator=(atomic_shared_function const&) = delete;
+
+  /// @note No thread may call the function while it is destroyed.
+  ~atomic_shared_function();
+
+  Ret operator()(Args... args) const;
+
+  explicit operator bool() const;
+
+  /// Returns a copy of the current target.
+  target_t load() const;
+
+  /// Replaces the target, it is safe while other threads call the function.
+  void store(target_t func);
+
+  template <typename Func,
+            typename = Requires<Not<std::is_same<
+                typename std::decay<Func>::type, atomic_shared_function>>>,
+            typename = Requires<std::is_constructible<target_t, Func>>>
+  atomic_shared_function& operator=(Func&& func)
+  {
+    store(target_t(std::forward<Func>(func)));
+    return *this;
+  }
+
+  /// Destroys the replaced targets which are not being called anymore.
+  void collect();
+
+private:
+  static target_t* make_node(target_t func);
+
+  // moves the retired targets nobody calls anymore into garbage
+  void collect_locked(std::vector<target_t*>& garbage);
+
+  static void destroy(std::vector<target_t*> const& garbage) noexcept;
+
+  std::atomic<target_t*> mCurrent{nullptr};
+  std::mutex mWriteMutex;
+  std::vector<target_t*> mRetired;
+};
+
+template <typename Ret, typename... Args>
+atomic_shared_function<Ret(Args...)>::atomic_shared_function(target_t func)
+    : mCurrent(make_node(std::move(func)))
+{
+}
+
+template <typename Ret, typename... Args>
+atomic_shared_function<Ret(Args...)>::~atomic_shared_function()
+{
+  delete mCurrent.load(std::memory_order_relaxed);
+  for (auto node : mRetired)
+    delete node;
+}
+
+template <typename Ret, typename... Args>
+Ret atomic_shared_function<Ret(Args...)>::operator()(Args... args) const
+{
+  detail::hazard_guard guard;
+  auto const node = guard.protect(mCurrent);
+  if (!node)
+    throw std::bad_function_call();
+
+  return (*node)(std::forward<Args>(args)...);
+}
+
+template <typename Ret, typename... Args>
+atomic_shared_function<Ret(Args...)>::operator bool() const
+{
+  return mCurrent.load(std::memory_order_acquire) != nullptr;
+}
+
+template <typename Ret, typename... Args>
+auto atomic_shared_function<Ret(Args...)>::load() const -> target_t
+{
+  detail::hazard_guard guard;
+  auto const node = guard.protect(mCurrent);
+  return node ? *node : target_t();
+}
+
+template <typename Ret, typename... Args>
+void atomic_shared_function<Ret(Args...)>::store(target_t func)
+{
+  auto const node = make_node(std::move(func));
+
+  // targets are destroyed without the lock, they may store() again
+  std::vector<target_t*> garbage;
+  {
+    std::lock_guard<std::mutex> lock(mWriteMutex);
+    mRetired.reserve(mRetired.size() + 1);
+    auto const old = mCurrent.exchange(node, std::memory_order_seq_cst);
+    if (old)
+      mRetired.push_back(old);
+    collect_locked(garbage);
+  }
+  destroy(garbage);
+}
+
+template <typename Ret, typename... Args>
+void atomic_shared_function<Ret(Args...)>::collect()
+{
+  std::vector<target_t*> garbage;
+  {
+    std::lock_guard<std::mutex> lock(mWriteMutex);
+    collect_locked(garbage);
+  }
+  destroy(garbage);
+}
+
+template <typename Ret, typename... Args>
+auto atomic_shared_function<Ret(Args...)>::make_node(target_t func)
+    -> target_t*
+{
+  return func ? new target_t(std::move(func)) : nullptr;
+}
+
+template <typename Ret, typename... Args>
+void atomic_shared_function<Ret(Args...)>::collect_locked(
+    std::vector<target_t*>& garbage)
+{
+  auto const& domain = detail::hazard_domain::instance();
+
+  garbage.reserve(mRetired.size());
+  std::size_t kept = 0;
+  for (auto node : mRetired)
+    {
+      if (domain.is_protected(node))
+        mRetired[kept++] = node;
+      else
+        garbage.push_back(node);
+    }
+  mRetired.resize(kept);
+}
+
+template <typename Ret, typename... Args>
+void atomic_shared_function<Ret(Args...)>::destroy(
+    std::vector<target_t*> const& garbage) noexcept
+{
+  for (auto node : garbage)
+    delete node;
+}
+
+} // namespace ak
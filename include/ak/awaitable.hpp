@@ -0,0 +1,195 @@
+// Copyright (C) 2021 Artem Komyshan
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+/**
+ * @brief as_awaitable turns a callback based call into an awaitable. The
+ * callback is appended to \c args and the call is started when the awaitable
+ * is awaited:
+ *
+ * // void async_read(socket&, buffer, ak::call_once_silent<std::size_t>);
+ * std::size_t n = co_await ak::as_awaitable<std::size_t>(async_read, s, buf);
+ *
+ * The awaited value is nothing, the only result or a std::tuple of the
+ * results of the callback. The callback is a call_once_silent<Results...>
+ * which points to the awaitable, so the results are stored right in the
+ * coroutine frame and nothing is allocated. If the callback is destroyed
+ * without being called, co_await throws std::future_error with
+ * broken_promise.
+ *
+ * By default the coroutine is resumed on the thread which calls the
+ * callback. When an executor is given, it is resumed by a function posted
+ * there instead (see ak/executor.hpp). A callback called before the call
+ * returns continues the coroutine in place.
+ * @note Requires C++20 coroutines, the header is empty otherwise.
+ */
+
+#if defined(__cpp_impl_coroutine)
+
+#include <atomic>
+#include <coroutine>
+#include <functional>
+#include <future>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "ak/call_once_silent.hpp"
+#include "ak/callable_type_traits.hpp"
+#include "ak/requires.hpp"
+
+namespace ak
+{
+
+namespace detail
+{
+
+/// Resumes the coroutine on the completing thread.
+struct resume_inline
+{
+};
+
+template <typename Executor, typename Api, typename ArgsTuple,
+          typename... Results>
+class callback_awaitable
+{
+  enum state : unsigned char
+  {
+    started,
+    suspended,
+    completed
+  };
+
+  /// The target of the callback, a single pointer so it is stored inline.
+  class resumer
+  {
+  public:
+    explicit resumer(callback_awaitable* awaitable) noexcept
+        : mAwaitable(awaitable)
+    {
+    }
+
+    resumer(resumer&& o) noexcept
+        : mAwaitable(std::exchange(o.mAwaitable, nullptr))
+    {
+    }
+
+    resumer& operator=(resumer&&) = delete;
+
+    ~resumer()
+    {
+      if (mAwaitable)
+        mAwaitable->complete();
+    }
+
+    void operator()(Results... results)
+    {
+      auto const awaitable = std::exchange(mAwaitable, nullptr);
+      awaitable->mResult.emplace(std::forward<Results>(results)...);
+      awaitable->complete();
+    }
+
+  private:
+    callback_awaitable* mAwaitable;
+  };
+
+public:
+  callback_awaitable(Executor* executor, Api api, ArgsTuple args)
+      : mExecutor(executor)
+      , mApi(std::move(api))
+      , mArgs(std::move(args))
+  {
+  }
+
+  callback_awaitable(callback_awaitable const&) = delete;
+  callback_awaitable& operator=(callback_awaitable const&) = delete;
+
+  bool await_ready() const noexcept
+  {
+    return false;
+  }
+
+  /// Returns false to continue in place when the callback is already done.
+  bool await_suspend(std::coroutine_handle<> handle)
+  {
+    mHandle = handle;
+    std::apply(
+        [this](auto&... args) {
+          std::invoke(mApi, std::move(args)...,
+                      call_once_silent<Results...>(resumer(this)));
+        },
+        mArgs);
+    return mState.exchange(suspended, std::memory_order_acq_rel) != completed;
+  }
+
+  auto await_resume()
+  {
+    if (!mResult)
+      throw std::future_error(std::future_errc::broken_promise);
+
+    if constexpr (sizeof...(Results) == 1)
+      return std::get<0>(std::move(*mResult));
+    else if constexpr (sizeof...(Results) > 1)
+      return std::move(*mResult);
+  }
+
+private:
+  // the last of await_suspend and the callback resumes the coroutine
+  void complete()
+  {
+    if (mState.exchange(completed, std::memory_order_acq_rel) != suspended)
+      return;
+
+    if constexpr (std::is_same<Executor, resume_inline>::value)
+      mHandle.resume();
+    else
+      mExecutor->post(mHandle);
+  }
+
+  Executor* const mExecutor;
+  Api mApi;
+  ArgsTuple mArgs;
+  std::coroutine_handle<> mHandle;
+  std::optional<std::tuple<Results...>> mResult;
+  std::atomic<state> mState{started};
+};
+
+template <typename Executor, typename... Results, typename Api,
+          typename... Args>
+auto make_callback_awaitable(Executor* executor, Api&& api, Args&&... args)
+{
+  using args_t = std::tuple<typename std::decay<Args>::type...>;
+  return callback_awaitable<Executor, typename std::decay<Api>::type, args_t,
+                            Results...>(
+      executor, std::forward<Api>(api),
+      args_t(std::forward<Args>(args)...));
+}
+
+} // namespace detail
+
+/// \c api is invoked with \c args and a call_once_silent<Results...>.
+template <typename... Results, typename Api, typename... Args,
+          typename = Requires<Not<is_executor<typename std::decay<Api>::type>>>>
+auto as_awaitable(Api&& api, Args&&... args)
+{
+  return detail::make_callback_awaitable<detail::resume_inline, Results...>(
+      nullptr, std::forward<Api>(api), std::forward<Args>(args)...);
+}
+
+/// The coroutine is resumed through \c executor, which must outlive the wait.
+template <typename... Results, typename Executor, typename Api,
+          typename... Args, typename = Requires<is_executor<Executor>>>
+auto as_awaitable(Executor& executor, Api&& api, Args&&... args)
+{
+  return detail::make_callback_awaitable<Executor, Results...>(
+      &executor, std::forward<Api>(api), std::forward<Args>(args)...);
+}
+
+} // namespace ak
+
+#endif
@@ -6,33 +6,109 @@
 
 #pragma once
 
-#include <functional>
 #include <memory>
+#include <type_traits>
+#include <utility>
 
+#include "ak/call_once_silent.hpp"
+#include "ak/callable_type_traits.hpp"
 #include "ak/requires.hpp"
 
 /**
  * @brief The call_on_expire struct wraps function into shared_ptr and invokes
  * this function before deletion. In other words, the bound function is invoked
  * when the last remaining call_on_expire referred to the function is destroyed.
+ * When an executor is given, the last release only posts the function to it
+ * instead of running it on the releasing thread (see ak/executor.hpp). The
+ * post is made from a destructor, so the executor's post() must not throw:
+ * an exception there terminates the program.
+ *
+ * The function and the shared state live in a single block, which may be
+ * taken from an allocator:
+ *
+ * call_on_expire coe(std::allocator_arg, alloc, [] { done(); });
  */
 
 namespace ak
 {
 
-class call_on_expire
+namespace detail
+{
+
+struct expire_action
+{
+  explicit expire_action(call_once_silent<> a) noexcept : action(std::move(a))
+  {
+  }
+
+  ~expire_action()
+  {
+    action();
+  }
+
+  call_once_silent<> action;
+};
+
+template <typename Executor>
+struct posted_expire_action
 {
-  using call_t = std::function<void(void)>;
+  posted_expire_action(Executor& e, call_once_silent<> a) noexcept
+      : executor(e)
+      , action(std::move(a))
+  {
+  }
 
+  // implicitly noexcept, post() must not throw
+  ~posted_expire_action()
+  {
+    executor.post(std::move(action));
+  }
+
+  Executor& executor;
+  call_once_silent<> action;
+};
+
+} // namespace detail
+
+class call_on_expire
+{
 public:
   template <typename Func,
-            typename = Requires<Not<
-                std::is_same<typename std::decay<Func>::type, call_on_expire>>>>
+            typename = Requires<Not<std::is_base_of<
+                call_on_expire, typename std::decay<Func>::type>>>>
   call_on_expire(Func&& action)
-      : action_(new call_t(std::forward<Func>(action)), [](call_t* action) {
-        (*action)();
-        delete action;
-      })
+      : call_on_expire(std::allocator_arg, std::allocator<char>(),
+                       std::forward<Func>(action))
+  {
+  }
+
+  /// Takes the shared block and a big function from \c alloc.
+  template <typename Alloc, typename Func>
+  call_on_expire(std::allocator_arg_t, Alloc const& alloc, Func&& action)
+      : action_(std::allocate_shared<detail::expire_action>(
+            alloc, call_once_silent<>(std::allocator_arg, alloc,
+                                      std::forward<Func>(action))))
+  {
+  }
+
+  /// @note The executor must outlive all copies of call_on_expire and its
+  /// post() must not throw.
+  template <typename Executor, typename Func,
+            typename = Requires<is_executor<Executor>>>
+  call_on_expire(Executor& executor, Func&& action)
+      : call_on_expire(std::allocator_arg, std::allocator<char>(), executor,
+                       std::forward<Func>(action))
+  {
+  }
+
+  template <typename Alloc, typename Executor, typename Func,
+            typename = Requires<is_executor<Executor>>>
+  call_on_expire(std::allocator_arg_t, Alloc const& alloc, Executor& executor,
+                 Func&& action)
+      : action_(std::allocate_shared<detail::posted_expire_action<Executor>>(
+            alloc, executor,
+            call_once_silent<>(std::allocator_arg, alloc,
+                               std::forward<Func>(action))))
   {
   }
 
@@ -44,7 +120,7 @@ public:
   }
 
 private:
-  std::shared_ptr<call_t> action_;
+  std::shared_ptr<void> action_;
 };
 
 } // namespace ak
@@ -6,17 +6,24 @@
 
 #pragma once
 
+#include <atomic>
+#include <cstddef>
 #include <functional>
+#include <memory>
 #include <type_traits>
 #include <utility>
 
 #include "ak/callable_type_traits.hpp"
+#include "ak/detail/function_storage.hpp"
 #include "ak/requires.hpp"
 
 /**
- * @brief The call_once_silent class is std::function wrapper which allows this
+ * @brief The call_once_silent class is function wrapper which allows this
  * function to be invoked just once. in the case when the function is called
  * more than once, all calls starting from the second will be ignored
+ *
+ * The target is never copied, so move-only callables (capturing unique_ptr,
+ * std::promise and alike) are accepted. Small targets are stored inline.
  */
 
 namespace ak
@@ -31,25 +38,95 @@ class call_once_silent
   {
   };
 
+  using storage_t = detail::function_storage<default_function_capacity,
+                                             default_function_alignment>;
+
+  struct vtable
+  {
+    void (*invoke)(storage_t&, Args&&...);
+    void (*move)(storage_t&, storage_t&) noexcept;
+    void (*destroy)(storage_t&) noexcept;
+  };
+
+  template <typename Func, typename Alloc = std::allocator<char>>
+  struct vtable_for
+  {
+    using manager = detail::storage_manager<
+        Func, storage_t,
+        detail::is_inline_storable<Func, default_function_capacity,
+                                   default_function_alignment>::value,
+        Alloc>;
+
+    static void invoke(storage_t& storage, Args&&... args)
+    {
+      // std::invoke keeps pointers to members callable
+      std::invoke(manager::get(storage), std::forward<Args>(args)...);
+    }
+
+    static constexpr vtable value = {
+        &invoke, manager::trivially_relocatable ? nullptr : &manager::move,
+        manager::trivially_destructible ? nullptr : &manager::destroy};
+  };
+
 public:
   template <
       typename Func,
       typename = Requires<
           Not<std::is_same<typename std::decay<Func>::type, call_once_silent>>>,
       typename = Requires<Callable<Func>>>
-  call_once_silent(Func&& func) : mFunc(std::forward<Func>(func))
+  call_once_silent(Func&& func)
+      : mVTable(&vtable_for<typename std::decay<Func>::type>::value)
   {
+    using manager =
+        typename vtable_for<typename std::decay<Func>::type>::manager;
+    manager::create(mStorage, std::allocator<char>(), std::forward<Func>(func));
   }
 
-  call_once_silent() noexcept : mFunc(nullptr) {}
+  /// Allocates the target with \c alloc when it does not fit inline.
+  template <
+      typename Alloc, typename Func,
+      typename = Requires<
+          Not<std::is_same<typename std::decay<Func>::type, call_once_silent>>>,
+      typename = Requires<Callable<Func>>>
+  call_once_silent(std::allocator_arg_t, Alloc const& alloc, Func&& func)
+      : mVTable(&vtable_for<typename std::decay<Func>::type, Alloc>::value)
+  {
+    using manager =
+        typename vtable_for<typename std::decay<Func>::type, Alloc>::manager;
+    manager::create(mStorage, alloc, std::forward<Func>(func));
+  }
+
+  call_once_silent() noexcept : mVTable(nullptr) {}
 
-  call_once_silent(std::nullptr_t) noexcept : mFunc(nullptr) {}
+  call_once_silent(std::nullptr_t) noexcept : mVTable(nullptr) {}
 
   call_once_silent(call_once_silent const& o) = delete;
   call_once_silent& operator=(call_once_silent const& o) = delete;
 
-  call_once_silent(call_once_silent&& o) = default;
-  call_once_silent& operator=(call_once_silent&& o) = default;
+  call_once_silent(call_once_silent&& o) noexcept : mVTable(o.mVTable)
+  {
+    if (mVTable)
+      detail::relocate(mVTable->move, o.mStorage, mStorage);
+    o.mVTable = nullptr;
+  }
+
+  call_once_silent& operator=(call_once_silent&& o) noexcept
+  {
+    if (this != &o)
+      {
+        reset();
+        mVTable = o.mVTable;
+        if (mVTable)
+          detail::relocate(mVTable->move, o.mStorage, mStorage);
+        o.mVTable = nullptr;
+      }
+    return *this;
+  }
+
+  ~call_once_silent()
+  {
+    reset();
+  }
 
   template <
       typename Func,
@@ -58,34 +135,41 @@ public:
       typename = Requires<Callable<Func>>>
   call_once_silent& operator=(Func&& func)
   {
-    mFunc = std::forward<Func>(func);
-    return *this;
+    return *this = call_once_silent(std::forward<Func>(func));
   }
 
   call_once_silent& operator=(std::nullptr_t) noexcept
   {
-    mFunc = nullptr;
+    reset();
     return *this;
   }
 
   void operator()(Args... args)
   {
-    if (!mFunc)
+    if (!mVTable)
       return;
 
-    auto func = std::move(mFunc);
-    mFunc = nullptr;
-
-    func(std::forward<Args>(args)...);
+    // the target is moved out before the call, so it may safely reassign or
+    // destroy this object
+    call_once_silent func = std::move(*this);
+    func.mVTable->invoke(func.mStorage, std::forward<Args>(args)...);
   }
 
   explicit operator bool() const
   {
-    return mFunc != nullptr;
+    return mVTable != nullptr;
   }
 
 private:
-  std::function<void(Args...)> mFunc;
+  void reset() noexcept
+  {
+    if (mVTable && mVTable->destroy)
+      mVTable->destroy(mStorage);
+    mVTable = nullptr;
+  }
+
+  vtable const* mVTable;
+  storage_t mStorage;
 };
 
 // null pointer comparisons
@@ -112,4 +196,145 @@ bool operator!=(std::nullptr_t, call_once_silent<Args...> const& call) noexcept
   return static_cast<bool>(call);
 }
 
+/**
+ * @brief The concurrent_call_once_silent class is call_once_silent which may
+ * be invoked from several threads at once, e.g. by a timeout racing a
+ * response. The first caller claims the target with a single atomic exchange
+ * and runs it, the others return immediately.
+ * @note Assignment and move are not synchronized with concurrent calls.
+ */
+template <typename... Args>
+class concurrent_call_once_silent
+{
+  using target_t = call_once_silent<Args...>;
+
+public:
+  template <typename Func,
+            typename = Requires<Not<std::is_same<
+                typename std::decay<Func>::type, concurrent_call_once_silent>>>,
+            typename = Requires<std::is_constructible<target_t, Func>>>
+  concurrent_call_once_silent(Func&& func)
+      : concurrent_call_once_silent(target_t(std::forward<Func>(func)))
+  {
+  }
+
+  /// Allocates the target with \c alloc when it does not fit inline.
+  template <typename Alloc, typename Func>
+  concurrent_call_once_silent(std::allocator_arg_t, Alloc const& alloc,
+                              Func&& func)
+      : concurrent_call_once_silent(
+            target_t(std::allocator_arg, alloc, std::forward<Func>(func)))
+  {
+  }
+
+  concurrent_call_once_silent(target_t&& func) noexcept
+      : mFunc(std::move(func))
+      , mClaimed(!mFunc)
+  {
+  }
+
+  concurrent_call_once_silent() noexcept : mFunc(nullptr), mClaimed(true) {}
+
+  concurrent_call_once_silent(std::nullptr_t) noexcept
+      : concurrent_call_once_silent()
+  {
+  }
+
+  concurrent_call_once_silent(concurrent_call_once_silent const& o) = delete;
+  concurrent_call_once_silent&
+  operator=(concurrent_call_once_silent const& o) = delete;
+
+  concurrent_call_once_silent(concurrent_call_once_silent&& o) noexcept
+      : concurrent_call_once_silent(o.release())
+  {
+  }
+
+  concurrent_call_once_silent&
+  operator=(concurrent_call_once_silent&& o) noexcept
+  {
+    if (this != &o)
+      reset(o.release());
+    return *this;
+  }
+
+  template <typename Func,
+            typename = Requires<Not<std::is_same<
+                typename std::decay<Func>::type, concurrent_call_once_silent>>>,
+            typename = Requires<std::is_constructible<target_t, Func>>>
+  concurrent_call_once_silent& operator=(Func&& func)
+  {
+    reset(target_t(std::forward<Func>(func)));
+    return *this;
+  }
+
+  concurrent_call_once_silent& operator=(std::nullptr_t) noexcept
+  {
+    reset(nullptr);
+    return *this;
+  }
+
+  void operator()(Args... args)
+  {
+    // only the winner of the exchange touches the target
+    if (mClaimed.load(std::memory_order_relaxed) ||
+        mClaimed.exchange(true, std::memory_order_acquire))
+      return;
+
+    mFunc(std::forward<Args>(args)...);
+  }
+
+  explicit operator bool() const
+  {
+    return !mClaimed.load(std::memory_order_acquire);
+  }
+
+  /// Claims the target without calling it.
+  target_t release() noexcept
+  {
+    if (mClaimed.exchange(true, std::memory_order_acquire))
+      return nullptr;
+
+    return std::move(mFunc);
+  }
+
+private:
+  void reset(target_t func) noexcept
+  {
+    mFunc = std::move(func);
+    mClaimed.store(!mFunc, std::memory_order_release);
+  }
+
+  target_t mFunc;
+  std::atomic<bool> mClaimed;
+};
+
+// null pointer comparisons
+template <typename... Args>
+bool operator==(concurrent_call_once_silent<Args...> const& call,
+                std::nullptr_t) noexcept
+{
+  return !static_cast<bool>(call);
+}
+
+template <typename... Args>
+bool operator==(std::nullptr_t,
+                concurrent_call_once_silent<Args...> const& call) noexcept
+{
+  return !static_cast<bool>(call);
+}
+
+template <typename... Args>
+bool operator!=(concurrent_call_once_silent<Args...> const& call,
+                std::nullptr_t) noexcept
+{
+  return static_cast<bool>(call);
+}
+
+template <typename... Args>
+bool operator!=(std::nullptr_t,
+                concurrent_call_once_silent<Args...> const& call) noexcept
+{
+  return static_cast<bool>(call);
+}
+
 } // namespace ak
\ No newline at end of file
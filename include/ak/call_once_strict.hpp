@@ -6,6 +6,8 @@
 
 #pragma once
 
+#include <atomic>
+#include <cstddef>
 #include <functional>
 #include <optional>
 #include <type_traits>
@@ -17,60 +19,112 @@
  * @note Invoking the target of an empty call_once_strict results in
  * std::bad_function_call exception being thrown.
  * @note call_once_strict can be called multiple times, but the target is called
- * only once.
+ * only once. The call is claimed with a single compare-and-swap, so when
+ * several threads race exactly one of them runs the target and the others get
+ * the result of \c RepeatPolicy.
  */
 
 namespace ak
 {
 
-template <typename Func>
+/// Repeated calls throw std::bad_function_call.
+struct throw_on_repeat
+{
+  template <typename Ret>
+  static Ret on_repeat()
+  {
+    throw std::bad_function_call();
+  }
+};
+
+/// Repeated calls are ignored and return a default constructed value.
+struct ignore_repeat
+{
+  template <typename Ret>
+  static Ret on_repeat()
+  {
+    return Ret();
+  }
+};
+
+template <typename Func, typename RepeatPolicy = throw_on_repeat>
 class call_once_strict
 {
+  enum state : unsigned char
+  {
+    empty,
+    ready,
+    claimed
+  };
+
 public:
   ~call_once_strict() = default;
 
-  explicit call_once_strict(Func&& func) : mFunc(std::forward<Func>(func)) {}
+  explicit call_once_strict(Func func)
+      : mFunc(std::move(func))
+      , mState(initial_state(*mFunc))
+  {
+  }
 
-  call_once_strict() noexcept : mFunc(std::std::nullopt) {}
+  call_once_strict() noexcept : mFunc(std::nullopt), mState(empty) {}
 
-  call_once_strict(std::nullptr_t) noexcept : mFunc(std::std::nullopt) {}
+  call_once_strict(std::nullptr_t) noexcept : call_once_strict() {}
 
-  call_once_strict& operator=(Func&& func)
+  call_once_strict& operator=(Func func)
   {
-    mFunc = std::move(func);
+    mFunc.emplace(std::move(func));
+    mState.store(initial_state(*mFunc), std::memory_order_release);
     return *this;
   }
 
-  call_once_strict(call_once_strict const& o) noexcept : mFunc(o.mFunc) {}
+  /// Copying and moving are not synchronized with concurrent calls.
+  call_once_strict(call_once_strict const& o)
+      : mFunc(o.isValid() ? o.mFunc : std::nullopt)
+      , mState(mFunc ? ready : empty)
+  {
+  }
 
   call_once_strict& operator=(call_once_strict const& o)
   {
-    mFunc = o.mFunc;
+    if (this != &o)
+      {
+        assign(o.isValid() ? o.mFunc : std::nullopt);
+        mState.store(mFunc ? ready : empty, std::memory_order_release);
+      }
     return *this;
   }
 
-  call_once_strict(call_once_strict&& o) : mFunc(std::move(o.mFunc)) {}
+  call_once_strict(call_once_strict&& o) : call_once_strict()
+  {
+    *this = std::move(o);
+  }
 
   call_once_strict& operator=(call_once_strict&& o)
   {
-    mFunc = std::move(o.mFunc);
+    if (this != &o)
+      {
+        assign(o.release());
+        mState.store(mFunc ? ready : empty, std::memory_order_release);
+      }
     return *this;
   }
 
   call_once_strict& operator=(std::nullptr_t) noexcept
   {
-    mFunc = std::std::nullopt;
+    release();
     return *this;
   }
 
   template <typename... Args>
-  std::result_of_t<Func(Args...)> operator()(Args&&... args)
+  std::invoke_result_t<Func&, Args...> operator()(Args&&... args)
   {
-    if (!isValid())
-      throw std::bad_function_call();
+    using result_t = std::invoke_result_t<Func&, Args...>;
 
-    auto func = mFunc.release();
-    return func(std::forward<Args>(args)...);
+    auto func = release();
+    if (!func)
+      return RepeatPolicy::template on_repeat<result_t>();
+
+    return (*func)(std::forward<Args>(args)...);
   }
 
   explicit operator bool() const
@@ -78,18 +132,49 @@ public:
     return isValid();
   }
 
-  TProperty<Func> relese()
+  /**
+   * @brief release claims the target, after that the call_once_strict is
+   * empty. Returns std::nullopt if the target is already claimed.
+   */
+  std::optional<Func> release()
   {
-    return std::move(mFunc);
+    // losers only read the state, so its cache line is not bounced around
+    auto expected = ready;
+    if (mState.load(std::memory_order_relaxed) != ready ||
+        !mState.compare_exchange_strong(expected, claimed,
+                                        std::memory_order_acquire,
+                                        std::memory_order_relaxed))
+      return std::nullopt;
+
+    auto func = std::move(mFunc);
+    mFunc.reset();
+    return func;
   }
 
   bool isValid() const
   {
-    return mFunc.isValid() && mFunc.getValue() != nullptr;
+    return mState.load(std::memory_order_acquire) == ready;
   }
 
 private:
+  // lambdas are not assignable, so the target is always constructed anew
+  void assign(std::optional<Func> func)
+  {
+    mFunc.reset();
+    if (func)
+      mFunc.emplace(std::move(*func));
+  }
+
+  static state initial_state(Func const& func)
+  {
+    if constexpr (std::is_constructible<bool, Func const&>::value)
+      return static_cast<bool>(func) ? ready : empty;
+    else
+      return ready;
+  }
+
   std::optional<Func> mFunc;
+  std::atomic<state> mState;
 };
 
 template <typename Func>
@@ -99,28 +184,32 @@ call_once_strict<Func> makeTECallOnce(Func f)
 }
 
 // null pointer comparisons
-template <typename Func>
-bool operator==(call_once_strict<Func> const& call, std::nullptr_t) noexcept
+template <typename Func, typename RepeatPolicy>
+bool operator==(call_once_strict<Func, RepeatPolicy> const& call,
+                std::nullptr_t) noexcept
 {
   return !static_cast<bool>(call);
 }
 
-template <typename Func>
-bool operator==(std::nullptr_t, call_once_strict<Func> const& call) noexcept
+template <typename Func, typename RepeatPolicy>
+bool operator==(std::nullptr_t,
+                call_once_strict<Func, RepeatPolicy> const& call) noexcept
 {
   return !static_cast<bool>(call);
 }
 
-template <typename Func>
-bool operator!=(call_once_strict<Func> const& call, std::nullptr_t) noexcept
+template <typename Func, typename RepeatPolicy>
+bool operator!=(call_once_strict<Func, RepeatPolicy> const& call,
+                std::nullptr_t) noexcept
 {
   return static_cast<bool>(call);
 }
 
-template <typename Func>
-bool operator!=(std::nullptr_t, call_once_strict<Func> const& call) noexcept
+template <typename Func, typename RepeatPolicy>
+bool operator!=(std::nullptr_t,
+                call_once_strict<Func, RepeatPolicy> const& call) noexcept
 {
   return static_cast<bool>(call);
 }
 
-} // namespace ak
\ No newline at end of file
+} // namespace ak
@@ -7,6 +7,9 @@
 #pragma once
 
 #include <type_traits>
+#include <utility>
+
+#include "ak/requires.hpp"
 
 namespace ak
 {
@@ -15,4 +18,39 @@ template <typename From, typename To>
 using check_func_return_type =
     Or<std::is_void<To>, std::is_same<From, To>, std::is_convertible<From, To>>;
 
+template <typename Func>
+struct is_function_pointer
+    : And<std::is_pointer<Func>,
+          std::is_function<typename std::remove_pointer<Func>::type>>
+{
+};
+
+/// True for callables without state which convert to a plain function
+/// pointer, e.g. captureless lambdas. Wrappers may store the pointer instead.
+template <typename Func, typename = void>
+struct is_stateless_callable : std::false_type
+{
+};
+
+template <typename Func>
+struct is_stateless_callable<Func,
+                             std::void_t<decltype(+std::declval<Func&>())>>
+    : And<std::is_class<Func>, std::is_empty<Func>,
+          std::is_trivially_copyable<Func>,
+          is_function_pointer<decltype(+std::declval<Func&>())>>
+{
+};
+
+/// True for types with a member post(func), see ak/executor.hpp.
+template <typename T, typename = void>
+struct is_executor : std::false_type
+{
+};
+
+template <typename T>
+struct is_executor<T, std::void_t<decltype(std::declval<T&>().post(
+                          std::declval<void (*)()>()))>> : std::true_type
+{
+};
+
 }
\ No newline at end of file
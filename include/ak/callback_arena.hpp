@@ -0,0 +1,152 @@
+// Copyright (C) 2021 Artem Komyshan
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <memory_resource>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/**
+ * @brief callback_arena is a memory resource for callbacks which live as long
+ * as one request. Memory is handed out by bumping a pointer and is given back
+ * all at once when the arena is released or destroyed.
+ *
+ * Wrappers are bound to the arena by constructing them with its allocator,
+ * any object may be placed into the arena with create():
+ *
+ * ak::callback_arena arena;
+ * auto& done = arena.create<ak::call_once_silent<>>(
+ *     std::allocator_arg, arena.get_allocator(), [state] { finish(state); });
+ *
+ * Objects made by create() are destroyed in reverse order on release, those
+ * which are trivially destructible are not tracked at all. In debug builds
+ * the arena asserts that no bound wrapper outlives it.
+ * @note The arena is not thread-safe.
+ */
+
+namespace ak
+{
+
+class callback_arena : public std::pmr::memory_resource
+{
+public:
+  using allocator_type = std::pmr::polymorphic_allocator<std::byte>;
+
+  explicit callback_arena(
+      std::size_t initial_size = 1024,
+      std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+      : mBuffer(initial_size, upstream)
+  {
+  }
+
+  /// Bump allocation starts in \c buffer and continues from \c upstream.
+  callback_arena(
+      void* buffer, std::size_t size,
+      std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+      : mBuffer(buffer, size, upstream)
+  {
+  }
+
+  callback_arena(callback_arena const&) = delete;
+  callback_arena& operator=(callback_arena const&) = delete;
+
+  ~callback_arena() override
+  {
+    release();
+  }
+
+  allocator_type get_allocator() noexcept
+  {
+    return allocator_type(this);
+  }
+
+  /// Constructs \c T in the arena, it is destroyed by release().
+  template <typename T, typename... CArgs>
+  T& create(CArgs&&... args);
+
+  /// Moves or copies \c func into the arena, e.g. a guarded callback.
+  template <typename Func>
+  std::decay_t<Func>& store(Func&& func)
+  {
+    return create<std::decay_t<Func>>(std::forward<Func>(func));
+  }
+
+  /// Destroys the created objects and gives all memory back at once.
+  void release() noexcept;
+
+private:
+  struct cleanup
+  {
+    void (*destroy)(void*) noexcept;
+    void* object;
+    cleanup* next;
+  };
+
+  template <typename T>
+  static void destroy_object(void* object) noexcept
+  {
+    static_cast<T*>(object)->~T();
+  }
+
+  void* do_allocate(std::size_t bytes, std::size_t alignment) override
+  {
+    auto p = mBuffer.allocate(bytes, alignment);
+    ++mLive;
+    return p;
+  }
+
+  void do_deallocate(void*, std::size_t, std::size_t) override
+  {
+    // memory is only given back by release()
+    assert(mLive > 0);
+    --mLive;
+  }
+
+  bool do_is_equal(std::pmr::memory_resource const& other) const
+      noexcept override
+  {
+    return this == &other;
+  }
+
+  std::pmr::monotonic_buffer_resource mBuffer;
+  cleanup* mCleanups = nullptr;
+  // blocks handed out through the memory_resource and not deallocated yet,
+  // the layout does not depend on NDEBUG
+  std::size_t mLive = 0;
+};
+
+template <typename T, typename... CArgs>
+T& callback_arena::create(CArgs&&... args)
+{
+  if constexpr (std::is_trivially_destructible<T>::value)
+    return *::new (mBuffer.allocate(sizeof(T), alignof(T)))
+        T(std::forward<CArgs>(args)...);
+  else
+    {
+      // the record is taken first, so a constructed object is never lost
+      auto record = mBuffer.allocate(sizeof(cleanup), alignof(cleanup));
+      auto object = ::new (mBuffer.allocate(sizeof(T), alignof(T)))
+          T(std::forward<CArgs>(args)...);
+      mCleanups = ::new (record) cleanup{&destroy_object<T>, object, mCleanups};
+      return *object;
+    }
+}
+
+inline void callback_arena::release() noexcept
+{
+  for (auto c = mCleanups; c; c = c->next)
+    c->destroy(c->object);
+  mCleanups = nullptr;
+
+  assert(mLive == 0 && "a wrapper bound to callback_arena outlives it");
+  mBuffer.release();
+}
+
+} // namespace ak
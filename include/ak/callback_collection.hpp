@@ -0,0 +1,163 @@
+// Copyright (C) 2021 Artem Komyshan
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "ak/callable_type_traits.hpp"
+#include "ak/requires.hpp"
+
+/**
+ * @brief callback_collection keeps callables grouped by their concrete type.
+ * Every type gets its own segment, a vector of objects of exactly that type,
+ * so invoking the collection is one indirect call per segment followed by a
+ * loop of direct, inlinable calls over contiguous memory.
+ *
+ * ak::callback_collection<void(Event const&)> subscribers;
+ * subscribers.insert([this](Event const& e) { on_event(e); });
+ * subscribers(event);
+ *
+ * Callables of the same type are invoked in the order of insertion, segments
+ * in the order their first callable was inserted.
+ * @note Callables must not be inserted while the collection is invoked.
+ */
+
+namespace ak
+{
+
+template <typename Signature>
+class callback_collection;
+
+template <typename... Args>
+class callback_collection<void(Args...)>
+{
+  template <typename Func,
+            typename Ret2 = typename std::result_of<Func&(Args&...)>::type>
+  struct Callable : check_func_return_type<Ret2, void>
+  {
+  };
+
+  /// Its address identifies a callable type without RTTI.
+  template <typename Func>
+  static constexpr char key = 0;
+
+  struct segment_base
+  {
+    explicit segment_base(void const* k) noexcept : key(k) {}
+
+    virtual ~segment_base() = default;
+    virtual void invoke(Args&... args) = 0;
+    virtual std::size_t size() const noexcept = 0;
+    virtual void clear() noexcept = 0;
+
+    void const* const key;
+  };
+
+  template <typename Func>
+  struct segment final : segment_base
+  {
+    segment() noexcept : segment_base(&key<Func>) {}
+
+    void invoke(Args&... args) override
+    {
+      for (auto& func : items)
+        func(args...);
+    }
+
+    std::size_t size() const noexcept override
+    {
+      return items.size();
+    }
+
+    void clear() noexcept override
+    {
+      items.clear();
+    }
+
+    std::vector<Func> items;
+  };
+
+public:
+  template <typename Func, typename = Requires<Callable<Func>>>
+  void insert(Func&& func);
+
+  /// Number of callables of all types.
+  std::size_t size() const noexcept;
+
+  bool empty() const noexcept
+  {
+    return size() == 0;
+  }
+
+  /// Number of distinct callable types.
+  std::size_t segment_count() const noexcept
+  {
+    return mSegments.size();
+  }
+
+  /// Removes every callable, the segments are kept for reuse.
+  void clear() noexcept;
+
+  void operator()(Args... args);
+
+private:
+  template <typename Func>
+  segment<Func>& segment_for();
+
+  std::vector<std::unique_ptr<segment_base>> mSegments;
+};
+
+template <typename... Args>
+template <typename Func, typename>
+void callback_collection<void(Args...)>::insert(Func&& func)
+{
+  segment_for<typename std::decay<Func>::type>().items.push_back(
+      std::forward<Func>(func));
+}
+
+template <typename... Args>
+std::size_t callback_collection<void(Args...)>::size() const noexcept
+{
+  std::size_t total = 0;
+  for (auto& s : mSegments)
+    total += s->size();
+  return total;
+}
+
+template <typename... Args>
+void callback_collection<void(Args...)>::clear() noexcept
+{
+  for (auto& s : mSegments)
+    s->clear();
+}
+
+template <typename... Args>
+void callback_collection<void(Args...)>::operator()(Args... args)
+{
+  for (auto& s : mSegments)
+    s->invoke(args...);
+}
+
+template <typename... Args>
+template <typename Func>
+auto callback_collection<void(Args...)>::segment_for() -> segment<Func>&
+{
+  // a collection holds a handful of types, a scan beats hashing; the newest
+  // segments are the likeliest to be extended
+  for (auto s = mSegments.rbegin(); s != mSegments.rend(); ++s)
+    if ((*s)->key == &key<Func>)
+      return static_cast<segment<Func>&>(**s);
+
+  mSegments.push_back(std::make_unique<segment<Func>>());
+  return static_cast<segment<Func>&>(*mSegments.back());
+}
+
+} // namespace ak
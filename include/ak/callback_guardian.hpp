@@ -6,22 +6,76 @@
 
 #pragma once
 
-#include <functional>
-#include <memory>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "ak/callable_type_traits.hpp"
+#include "ak/detail/guard_slot.hpp"
+#include "ak/requires.hpp"
 
 /**
  * @brief The callback_guardian
  * Inheriting from this class or composition of it allows safe capturing "this"
  * to any callable object via make_guarded_callback.
+ *
+ * A guardian owns a slot of a process wide pool, guarded callbacks carry a
+ * pointer to the slot and its generation. Checking the owner is one load and
+ * compare, copying a guarded callback copies two words.
  */
 
 namespace ak
 {
 
+namespace detail
+{
+
+template <typename ErrorFunc>
+void report_expired(ErrorFunc const& error)
+{
+  if constexpr (std::is_same<ErrorFunc, std::nullptr_t>::value)
+    return;
+  else if constexpr (std::is_constructible<bool, ErrorFunc const&>::value)
+    {
+      if (error)
+        error();
+    }
+  else
+    error();
+}
+
+// the returned callback posts a copy of guarded with the call arguments
+template <typename Executor, typename Guarded>
+auto post_on_call(Executor& executor, Guarded guarded)
+{
+  return [&executor, guarded = std::move(guarded)](auto&&... args) {
+    executor.post(
+        [guarded, args = std::make_tuple(
+                      std::forward<decltype(args)>(args)...)]() mutable {
+          std::apply(guarded, std::move(args));
+        });
+  };
+}
+
+} // namespace detail
+
+template <typename Signature, std::size_t Capacity, std::size_t Align>
+class signal;
+
 class callback_guardian
 {
+  // checks the token of the owner itself, see ak/signal.hpp
+  template <typename, std::size_t, std::size_t>
+  friend class signal;
+
 public:
-  callback_guardian() : shared(std::make_shared<int>()) {}
+  callback_guardian()
+      : token(detail::guard_slot_pool::instance().acquire())
+  {
+  }
 
   callback_guardian(callback_guardian const&) : callback_guardian() {}
 
@@ -31,6 +85,20 @@ public:
     return *this;
   }
 
+  ~callback_guardian()
+  {
+    detail::guard_slot_pool::instance().release(token);
+  }
+
+  /**
+   * @brief invalidate_all expires all callbacks made so far, the owner stays
+   * alive and new callbacks can be made.
+   */
+  void invalidate_all()
+  {
+    token = detail::guard_slot_pool::instance().renew(token);
+  }
+
   /**
    * @brief make_guarded_callback wraps provided function into other safe
    * function which checks owner availability before calling the target
@@ -41,22 +109,189 @@ public:
    * @return guarded callback that checks owner availability before call
    * \c target.
    */
-  template <typename Func>
-  auto make_guarded_callback(Func target,
-                             std::function<void()> error_cb = nullptr)
+  template <typename Func, typename ErrorFunc = std::nullptr_t,
+            typename = Requires<Not<is_executor<Func>>>>
+  auto make_guarded_callback(Func target, ErrorFunc error_cb = nullptr)
   {
-    auto weak = std::weak_ptr<void>(shared);
-    return [weak, cb = std::move(target),
+    return [token = token, cb = std::move(target),
             error = std::move(error_cb)](auto&&... args) {
-      if (!weak.expired())
+      if (token.alive())
         cb(std::forward<decltype(args)>(args)...);
-      else if (error)
-        error();
+      else
+        detail::report_expired(error);
+    };
+  }
+
+  /**
+   * @brief make_guarded_callback makes a callback which posts the call to
+   * \c executor, the owner is checked when the call runs there.
+   * @note The executor must outlive the callback.
+   */
+  template <typename Executor, typename Func,
+            typename ErrorFunc = std::nullptr_t,
+            typename = Requires<is_executor<Executor>>>
+  auto make_guarded_callback(Executor& executor, Func target,
+                             ErrorFunc error_cb = nullptr)
+  {
+    return detail::post_on_call(
+        executor,
+        make_guarded_callback(std::move(target), std::move(error_cb)));
+  }
+
+private:
+  detail::guard_token token;
+};
+
+/**
+ * @brief The concurrent_callback_guardian
+ * Same as callback_guardian, but guarded callbacks may be invoked from any
+ * thread while the owner is destroyed. A running guarded call keeps the owner
+ * valid: the destructor marks the guardian expired and waits until calls that
+ * are already in flight return. Calls started later are rejected.
+ * Entering and leaving a call is a single atomic increment and decrement of a
+ * counter which lives on the guardian's own cache line, no mutex is involved.
+ * @note The guardian must be destroyed before the state used by the callbacks,
+ * so declare it as the last member or call expire() in the owner destructor.
+ */
+class concurrent_callback_guardian
+{
+  // calls running on the current thread, lets the owner to be destroyed from
+  // its own guarded callback
+  struct active_call
+  {
+    explicit active_call(detail::guard_token t) noexcept
+        : token(t)
+        , prev(top())
+    {
+      top() = this;
+    }
+
+    ~active_call()
+    {
+      top() = prev;
+      token.leave();
+      if (recycle)
+        detail::guard_slot_pool::instance().recycle(token.slot);
+    }
+
+    static active_call*& top() noexcept
+    {
+      thread_local active_call* head = nullptr;
+      return head;
+    }
+
+    detail::guard_token token;
+    active_call* prev;
+    // set on the outermost call of a guardian expired from its own callback,
+    // the slot is returned to the pool once that call leaves it
+    bool recycle = false;
+  };
+
+public:
+  concurrent_callback_guardian()
+      : token(detail::guard_slot_pool::instance().acquire())
+  {
+  }
+
+  concurrent_callback_guardian(concurrent_callback_guardian const&)
+      : concurrent_callback_guardian()
+  {
+  }
+
+  concurrent_callback_guardian& operator=(concurrent_callback_guardian const&)
+  {
+    // nothing should be copied
+    return *this;
+  }
+
+  ~concurrent_callback_guardian()
+  {
+    expire();
+  }
+
+  /**
+   * @brief expire rejects all further guarded calls and waits until the calls
+   * running on other threads return. The guardian can't be used afterwards.
+   */
+  void expire() noexcept
+  {
+    if (!token.slot)
+      return;
+
+    auto const reusable = detail::guard_slot_pool::expire(token);
+
+    std::uint64_t own = 0;
+    active_call* outermost = nullptr;
+    for (auto call = active_call::top(); call; call = call->prev)
+      if (call->token.slot == token.slot)
+        {
+          ++own;
+          outermost = call;
+        }
+
+    auto& word = token.slot->word;
+    while ((word.load(std::memory_order_acquire) &
+            detail::guard_slot::calls_mask) != own)
+      std::this_thread::yield();
+
+    if (reusable && outermost)
+      outermost->recycle = true;
+    else if (reusable)
+      detail::guard_slot_pool::instance().recycle(token.slot);
+    token.slot = nullptr;
+  }
+
+  /**
+   * @brief invalidate_all rejects all further calls of the callbacks made so
+   * far, the owner stays alive and new callbacks can be made. Calls which are
+   * already running are not waited for.
+   */
+  void invalidate_all()
+  {
+    token = detail::guard_slot_pool::instance().renew(token);
+  }
+
+  /**
+   * @brief make_guarded_callback wraps provided function into other safe
+   * function which holds the owner alive while \c target runs.
+   * @param target - callback which needs to check before calling.
+   * @param error_cb - message which is logged when \c target is called but
+   * owner is destroyed.
+   * @return guarded callback that checks owner availability before call
+   * \c target.
+   */
+  template <typename Func, typename ErrorFunc = std::nullptr_t,
+            typename = Requires<Not<is_executor<Func>>>>
+  auto make_guarded_callback(Func target, ErrorFunc error_cb = nullptr)
+  {
+    return [token = token, cb = std::move(target),
+            error = std::move(error_cb)](auto&&... args) {
+      if (!token.enter())
+        return detail::report_expired(error);
+
+      active_call call(token);
+      cb(std::forward<decltype(args)>(args)...);
     };
   }
 
+  /**
+   * @brief make_guarded_callback makes a callback which posts the call to
+   * \c executor, the owner is held alive while the call runs there.
+   * @note The executor must outlive the callback.
+   */
+  template <typename Executor, typename Func,
+            typename ErrorFunc = std::nullptr_t,
+            typename = Requires<is_executor<Executor>>>
+  auto make_guarded_callback(Executor& executor, Func target,
+                             ErrorFunc error_cb = nullptr)
+  {
+    return detail::post_on_call(
+        executor,
+        make_guarded_callback(std::move(target), std::move(error_cb)));
+  }
+
 private:
-  std::shared_ptr<int> shared;
+  detail::guard_token token;
 };
 
 } // namespace ak
@@ -0,0 +1,233 @@
+// Copyright (C) 2020 Artem Komyshan
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace ak
+{
+
+/// Inline buffer size of the function wrappers. Together with the dispatch
+/// pointer the wrapper occupies exactly one 64 byte cache line.
+constexpr std::size_t default_function_capacity = 6 * sizeof(void*);
+
+constexpr std::size_t default_function_alignment = alignof(std::max_align_t);
+
+namespace detail
+{
+
+/**
+ * @brief function_storage is a raw buffer for a type erased callable. The
+ * callable is constructed right inside of \c buffer when it fits, otherwise it
+ * is allocated on the heap and \c heap points to it.
+ */
+template <std::size_t Capacity, std::size_t Align>
+union function_storage
+{
+  void* heap;
+  alignas(Align) unsigned char buffer[Capacity];
+};
+
+template <typename Func, std::size_t Capacity, std::size_t Align>
+struct is_inline_storable
+    : std::integral_constant<
+          bool, sizeof(Func) <= Capacity && Align % alignof(Func) == 0 &&
+                    std::is_nothrow_move_constructible<Func>::value>
+{
+};
+
+/**
+ * @brief heap_box is the heap block of a target which does not fit inline.
+ * It keeps the allocator the block came from, copies are allocated with it.
+ */
+template <typename Func, typename Alloc>
+struct heap_box : Alloc
+{
+  template <typename... CArgs>
+  explicit heap_box(Alloc const& alloc, CArgs&&... args)
+      : Alloc(alloc)
+      , func(std::forward<CArgs>(args)...)
+  {
+  }
+
+  Alloc const& allocator() const noexcept
+  {
+    return *this;
+  }
+
+  Func func;
+};
+
+/// Allocates \c T with \c alloc rebound to it and constructs it from \c args.
+template <typename T, typename Alloc, typename... CArgs>
+T* allocate_object(Alloc const& alloc, CArgs&&... args)
+{
+  using alloc_t =
+      typename std::allocator_traits<Alloc>::template rebind_alloc<T>;
+  using traits = std::allocator_traits<alloc_t>;
+
+  alloc_t a(alloc);
+  auto p = traits::allocate(a, 1);
+  try
+    {
+      ::new (static_cast<void*>(std::addressof(*p)))
+          T(std::forward<CArgs>(args)...);
+    }
+  catch (...)
+    {
+      traits::deallocate(a, p, 1);
+      throw;
+    }
+  return std::addressof(*p);
+}
+
+/// Destroys \c p and gives its memory back to \c alloc.
+template <typename T, typename Alloc>
+void deallocate_object(Alloc const& alloc, T* p) noexcept
+{
+  using alloc_t =
+      typename std::allocator_traits<Alloc>::template rebind_alloc<T>;
+
+  alloc_t a(alloc);
+  p->~T();
+  std::allocator_traits<alloc_t>::deallocate(a, p, 1);
+}
+
+/**
+ * @brief storage_manager knows how to create, access, move, copy and destroy
+ * the callable of type \c Func inside of \c Storage. Targets which do not fit
+ * inline are allocated with \c Alloc.
+ */
+template <typename Func, typename Storage, bool Inline,
+          typename Alloc = std::allocator<char>>
+struct storage_manager;
+
+template <typename Func, typename Storage, typename Alloc>
+struct storage_manager<Func, Storage, true, Alloc>
+{
+  /// Moving the storage bytes is enough to move the target.
+  static constexpr bool trivially_relocatable =
+      std::is_trivially_copyable<Func>::value;
+
+  static constexpr bool trivially_destructible =
+      std::is_trivially_destructible<Func>::value;
+
+  /// Copying the storage bytes is enough to copy the target.
+  static constexpr bool trivially_copyable =
+      std::is_trivially_copyable<Func>::value;
+
+  template <typename... CArgs>
+  static void create(Storage& s, Alloc const&, CArgs&&... args)
+  {
+    ::new (static_cast<void*>(s.buffer)) Func(std::forward<CArgs>(args)...);
+  }
+
+  static Func& get(Storage& s) noexcept
+  {
+    return *std::launder(reinterpret_cast<Func*>(s.buffer));
+  }
+
+  static Func const& get(Storage const& s) noexcept
+  {
+    return *std::launder(reinterpret_cast<Func const*>(s.buffer));
+  }
+
+  static void destroy(Storage& s) noexcept
+  {
+    get(s).~Func();
+  }
+
+  static void move(Storage& from, Storage& to) noexcept
+  {
+    ::new (static_cast<void*>(to.buffer)) Func(std::move(get(from)));
+    destroy(from);
+  }
+
+  static void copy(Storage const& from, Storage& to)
+  {
+    ::new (static_cast<void*>(to.buffer)) Func(get(from));
+  }
+};
+
+template <typename Func, typename Storage, typename Alloc>
+struct storage_manager<Func, Storage, false, Alloc>
+{
+  using box_t = heap_box<Func, Alloc>;
+
+  static constexpr bool trivially_relocatable = true;
+
+  static constexpr bool trivially_destructible = false;
+
+  static constexpr bool trivially_copyable = false;
+
+  template <typename... CArgs>
+  static void create(Storage& s, Alloc const& alloc, CArgs&&... args)
+  {
+    s.heap = allocate_object<box_t>(alloc, alloc, std::forward<CArgs>(args)...);
+  }
+
+  static Func& get(Storage& s) noexcept
+  {
+    return static_cast<box_t*>(s.heap)->func;
+  }
+
+  static Func const& get(Storage const& s) noexcept
+  {
+    return static_cast<box_t const*>(s.heap)->func;
+  }
+
+  static void destroy(Storage& s) noexcept
+  {
+    auto box = static_cast<box_t*>(s.heap);
+    deallocate_object(Alloc(box->allocator()), box);
+  }
+
+  static void move(Storage& from, Storage& to) noexcept
+  {
+    to.heap = from.heap;
+    from.heap = nullptr;
+  }
+
+  static void copy(Storage const& from, Storage& to)
+  {
+    auto box = static_cast<box_t const*>(from.heap);
+    create(to, box->allocator(), box->func);
+  }
+};
+
+/// Moves the target from \c from to \c to, \c move is null for trivially
+/// relocatable targets. Likewise wrappers leave \c destroy null for targets
+/// that do not need it.
+template <typename Storage>
+inline void relocate(void (*move)(Storage&, Storage&) noexcept, Storage& from,
+                     Storage& to) noexcept
+{
+  if (move)
+    move(from, to);
+  else
+    std::memcpy(&to, &from, sizeof(Storage));
+}
+
+/// Copies the target from \c from to \c to, \c copy is null for trivially
+/// copyable targets.
+template <typename Storage>
+inline void copy(void (*copy)(Storage const&, Storage&), Storage const& from,
+                 Storage& to)
+{
+  if (copy)
+    copy(from, to);
+  else
+    std::memcpy(&to, &from, sizeof(Storage));
+}
+
+} // namespace detail
+} // namespace ak
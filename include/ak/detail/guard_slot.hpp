@@ -0,0 +1,149 @@
+// Copyright (C) 2021 Artem Komyshan
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+
+namespace ak
+{
+namespace detail
+{
+
+/**
+ * @brief guard_slot is the liveness record of one callback guardian. The
+ * upper half of \c word is the generation: it is bumped whenever the guardian
+ * expires, which invalidates every token issued for the previous generation.
+ * The lower half counts guarded calls in flight for the concurrent guardian.
+ */
+struct alignas(64) guard_slot
+{
+  static constexpr unsigned generation_shift = 32;
+  static constexpr std::uint64_t one_generation = std::uint64_t(1)
+                                                  << generation_shift;
+  static constexpr std::uint64_t calls_mask = one_generation - 1;
+
+  static std::uint32_t generation_of(std::uint64_t word) noexcept
+  {
+    return static_cast<std::uint32_t>(word >> generation_shift);
+  }
+
+  std::atomic<std::uint64_t> word{0};
+  guard_slot* next_free = nullptr;
+};
+
+/**
+ * @brief guard_token identifies one generation of a guard_slot. It is
+ * trivially copyable and checking it is a single load and compare.
+ */
+struct guard_token
+{
+  bool alive() const noexcept
+  {
+    return guard_slot::generation_of(
+               slot->word.load(std::memory_order_acquire)) == generation;
+  }
+
+  /// Registers a call in flight, returns false if the token is expired.
+  bool enter() const noexcept
+  {
+    auto const word = slot->word.fetch_add(1, std::memory_order_acquire);
+    if (guard_slot::generation_of(word) == generation)
+      return true;
+
+    slot->word.fetch_sub(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  void leave() const noexcept
+  {
+    slot->word.fetch_sub(1, std::memory_order_release);
+  }
+
+  guard_slot* slot;
+  std::uint32_t generation;
+};
+
+/**
+ * @brief guard_slot_pool hands out guard slots from chunks that are never
+ * freed, so a token may be checked at any time, even after its guardian is
+ * gone. Released slots are reused unless their generation is exhausted.
+ */
+class guard_slot_pool
+{
+  static constexpr std::size_t chunk_size = 64;
+
+public:
+  static guard_slot_pool& instance()
+  {
+    // intentionally leaked, callbacks may be invoked during static destruction
+    static auto* pool = new guard_slot_pool;
+    return *pool;
+  }
+
+  guard_token acquire()
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (!mFree)
+      {
+        auto chunk = new guard_slot[chunk_size];
+        for (auto i = chunk_size; i > 0; --i)
+          {
+            chunk[i - 1].next_free = mFree;
+            mFree = &chunk[i - 1];
+          }
+      }
+
+    auto slot = mFree;
+    mFree = slot->next_free;
+    return {slot, guard_slot::generation_of(
+                      slot->word.load(std::memory_order_relaxed))};
+  }
+
+  /// Expires every token of \c token's generation and returns the slot.
+  void release(guard_token token) noexcept
+  {
+    if (expire(token))
+      recycle(token.slot);
+  }
+
+  /// Expires every token of \c token's generation, returns a fresh token.
+  guard_token renew(guard_token token)
+  {
+    if (!expire(token))
+      return acquire();
+
+    return {token.slot, token.generation + 1};
+  }
+
+  /// Expires every token of \c token's generation. Returns false if the slot
+  /// can't be used anymore: the next generation would wrap around and match
+  /// tokens of the past.
+  static bool expire(guard_token token) noexcept
+  {
+    token.slot->word.fetch_add(guard_slot::one_generation,
+                               std::memory_order_acq_rel);
+    return token.generation + 1 != std::numeric_limits<std::uint32_t>::max();
+  }
+
+  void recycle(guard_slot* slot) noexcept
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    slot->next_free = mFree;
+    mFree = slot;
+  }
+
+private:
+  std::mutex mMutex;
+  guard_slot* mFree = nullptr;
+};
+
+} // namespace detail
+} // namespace ak
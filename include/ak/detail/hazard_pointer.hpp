@@ -0,0 +1,174 @@
+// Copyright (C) 2021 Artem Komyshan
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+namespace ak
+{
+namespace detail
+{
+
+/// A chunk of hazard pointers, more chunks are chained when protected
+/// accesses nest deeper than one chunk holds. Chunks are never freed.
+struct hazard_slots
+{
+  static constexpr std::size_t count = 8;
+
+  std::atomic<void const*> slots[count] = {};
+  std::atomic<hazard_slots*> next{nullptr};
+};
+
+/**
+ * @brief hazard_record holds the hazard pointers of one thread: the objects
+ * the thread is using right now, which must not be deleted. A thread takes a
+ * record on its first protected access and gives it back on exit, records are
+ * never freed.
+ */
+struct alignas(64) hazard_record
+{
+  /// The slot of the protected access at \c depth, accesses may nest, e.g. a
+  /// handler calling another handler. Only the owning thread calls it.
+  std::atomic<void const*>& slot(std::size_t depth)
+  {
+    auto chunk = &slots;
+    for (; depth >= hazard_slots::count; depth -= hazard_slots::count)
+      {
+        auto next = chunk->next.load(std::memory_order_relaxed);
+        if (!next)
+          {
+            next = new hazard_slots;
+            chunk->next.store(next, std::memory_order_release);
+          }
+        chunk = next;
+      }
+    return chunk->slots[depth];
+  }
+
+  hazard_slots slots;
+  std::atomic<bool> active{false};
+  hazard_record* next = nullptr;
+  std::size_t depth = 0;
+};
+
+class hazard_domain
+{
+public:
+  static hazard_domain& instance()
+  {
+    // intentionally leaked, like the records
+    static auto* domain = new hazard_domain;
+    return *domain;
+  }
+
+  hazard_record& acquire()
+  {
+    for (auto r = mHead.load(std::memory_order_acquire); r; r = r->next)
+      {
+        auto expected = false;
+        if (!r->active.load(std::memory_order_relaxed) &&
+            r->active.compare_exchange_strong(expected, true,
+                                              std::memory_order_acquire))
+          return *r;
+      }
+
+    auto r = new hazard_record;
+    r->active.store(true, std::memory_order_relaxed);
+    r->next = mHead.load(std::memory_order_relaxed);
+    while (!mHead.compare_exchange_weak(r->next, r, std::memory_order_release,
+                                        std::memory_order_relaxed))
+      {
+      }
+    return *r;
+  }
+
+  static void release(hazard_record& r) noexcept
+  {
+    r.active.store(false, std::memory_order_release);
+  }
+
+  /// True if any thread protects \c object.
+  bool is_protected(void const* object) const noexcept
+  {
+    for (auto r = mHead.load(std::memory_order_acquire); r; r = r->next)
+      for (auto chunk = &r->slots; chunk;
+           chunk = chunk->next.load(std::memory_order_acquire))
+        for (auto& slot : chunk->slots)
+          if (slot.load(std::memory_order_seq_cst) == object)
+            return true;
+    return false;
+  }
+
+  /// The record of the calling thread.
+  static hazard_record& local()
+  {
+    struct holder
+    {
+      holder() : record(instance().acquire()) {}
+
+      ~holder()
+      {
+        release(record);
+      }
+
+      hazard_record& record;
+    };
+
+    thread_local holder self;
+    return self.record;
+  }
+
+private:
+  std::atomic<hazard_record*> mHead{nullptr};
+};
+
+/**
+ * @brief hazard_guard publishes one hazard pointer of the calling thread for
+ * its lifetime.
+ */
+class hazard_guard
+{
+public:
+  hazard_guard()
+      : mRecord(hazard_domain::local())
+      , mSlot(&mRecord.slot(mRecord.depth))
+  {
+    ++mRecord.depth;
+  }
+
+  hazard_guard(hazard_guard const&) = delete;
+  hazard_guard& operator=(hazard_guard const&) = delete;
+
+  ~hazard_guard()
+  {
+    mSlot->store(nullptr, std::memory_order_release);
+    --mRecord.depth;
+  }
+
+  /// Loads \c source and protects the loaded object from deletion.
+  template <typename T>
+  T* protect(std::atomic<T*> const& source) noexcept
+  {
+    auto object = source.load(std::memory_order_relaxed);
+    for (;;)
+      {
+        mSlot->store(object, std::memory_order_seq_cst);
+        auto const current = source.load(std::memory_order_seq_cst);
+        if (current == object)
+          return object;
+        object = current;
+      }
+  }
+
+private:
+  hazard_record& mRecord;
+  std::atomic<void const*>* mSlot;
+};
+
+} // namespace detail
+} // namespace ak
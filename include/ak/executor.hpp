@@ -0,0 +1,32 @@
+// Copyright (C) 2021 Artem Komyshan
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <utility>
+
+/**
+ * Executors run callbacks on behalf of the wrappers. An executor is any type
+ * with a member function post(func) that eventually invokes func() once.
+ * ak/thread_pool.hpp provides a pool of worker threads, ak/task_queue.hpp a
+ * queue drained by a thread of the user's choice.
+ */
+
+namespace ak
+{
+
+/// Invokes the posted function immediately on the posting thread.
+class inline_executor
+{
+public:
+  template <typename Func>
+  void post(Func&& func)
+  {
+    std::forward<Func>(func)();
+  }
+};
+
+} // namespace ak
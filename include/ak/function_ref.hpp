@@ -0,0 +1,192 @@
+// Copyright (C) 2020 Artem Komyshan
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+#include "ak/callable_type_traits.hpp"
+#include "ak/requires.hpp"
+
+/**
+ * function_ref is a non-owning reference to a callable. It is two pointers
+ * wide, trivially copyable, never allocates and, like not_empty_function,
+ * never refers to nothing. The referred callable must outlive the
+ * function_ref, which makes it a parameter type for synchronous callbacks.
+ *
+ * // the callback is not stored, so nothing is allocated
+ * void for_each_item(function_ref<void(item const&)> visit);
+ *
+ */
+
+namespace ak
+{
+
+template <typename Signature>
+class function_ref;
+
+template <typename Ret, typename... Args>
+class function_ref<Ret(Args...)>
+{
+  template <typename Func,
+            typename Ret2 = typename std::result_of<Func&(Args...)>::type>
+  struct Callable : check_func_return_type<Ret2, Ret>
+  {
+  };
+
+  union storage_t
+  {
+    void* object;
+    void (*function)();
+  };
+
+  template <typename Func>
+  static Ret invoke_object(storage_t storage, Args&&... args);
+
+  template <typename Func>
+  static Ret invoke_function(storage_t storage, Args&&... args);
+
+public:
+  explicit operator bool() const;
+
+  Ret operator()(Args... args) const;
+
+  /// Constructors create an empty function_ref are deleted.
+  function_ref() = delete;
+  function_ref(std::nullptr_t) = delete;
+  function_ref& operator=(std::nullptr_t) = delete;
+
+  function_ref(const function_ref& other) = default;
+  function_ref& operator=(const function_ref& other) = default;
+
+  template <typename Func,
+            typename = Requires<Not<
+                std::is_same<typename std::decay<Func>::type, function_ref>>>,
+            typename = Requires<Callable<Func>>>
+  function_ref(Func&& call) noexcept;
+
+  void swap(function_ref& other) noexcept;
+
+private:
+  Ret (*mCallback)(storage_t, Args&&...);
+  storage_t mStorage;
+};
+
+template <typename Ret, typename... Args>
+template <typename Func>
+Ret function_ref<Ret(Args...)>::invoke_object(storage_t storage,
+                                              Args&&... args)
+{
+  // std::invoke keeps pointers to members callable
+  auto& f = *static_cast<Func*>(storage.object);
+  if constexpr (std::is_void<Ret>::value)
+    std::invoke(f, std::forward<Args>(args)...);
+  else
+    return std::invoke(f, std::forward<Args>(args)...);
+}
+
+template <typename Ret, typename... Args>
+template <typename Func>
+Ret function_ref<Ret(Args...)>::invoke_function(storage_t storage,
+                                                Args&&... args)
+{
+  auto f = reinterpret_cast<Func>(storage.function);
+  if constexpr (std::is_void<Ret>::value)
+    f(std::forward<Args>(args)...);
+  else
+    return f(std::forward<Args>(args)...);
+}
+
+template <typename Ret, typename... Args>
+template <typename Func, typename, typename>
+function_ref<Ret(Args...)>::function_ref(Func&& call) noexcept
+{
+  using decayed_t = typename std::decay<Func>::type;
+
+  if constexpr (std::is_constructible<bool, decayed_t const&>::value)
+    assert(static_cast<bool>(call));
+
+  if constexpr (std::is_pointer<decayed_t>::value &&
+                std::is_function<
+                    typename std::remove_pointer<decayed_t>::type>::value)
+    {
+      mCallback = &invoke_function<decayed_t>;
+      mStorage.function = reinterpret_cast<void (*)()>(decayed_t(call));
+    }
+  else
+    {
+      using object_t = typename std::remove_reference<Func>::type;
+      mCallback = &invoke_object<object_t>;
+      mStorage.object = const_cast<void*>(
+          static_cast<void const volatile*>(std::addressof(call)));
+    }
+}
+
+template <typename Ret, typename... Args>
+function_ref<Ret(Args...)>::operator bool() const
+{
+  assert(mCallback);
+  return true;
+}
+
+template <typename Ret, typename... Args>
+Ret function_ref<Ret(Args...)>::operator()(Args... args) const
+{
+  return mCallback(mStorage, std::forward<Args>(args)...);
+}
+
+template <typename Ret, typename... Args>
+void function_ref<Ret(Args...)>::swap(function_ref& other) noexcept
+{
+  std::swap(mCallback, other.mCallback);
+  std::swap(mStorage, other.mStorage);
+}
+
+template <typename Ret, typename... Args>
+inline bool operator==(const function_ref<Ret(Args...)>& func,
+                       std::nullptr_t) noexcept
+{
+  return !static_cast<bool>(func);
+}
+
+template <typename Ret, typename... Args>
+inline bool operator==(std::nullptr_t,
+                       const function_ref<Ret(Args...)>& func) noexcept
+{
+  return !static_cast<bool>(func);
+}
+
+template <typename Ret, typename... Args>
+inline bool operator!=(const function_ref<Ret(Args...)>& func,
+                       std::nullptr_t) noexcept
+{
+  return static_cast<bool>(func);
+}
+
+template <typename Ret, typename... Args>
+inline bool operator!=(std::nullptr_t,
+                       const function_ref<Ret(Args...)>& func) noexcept
+{
+  return static_cast<bool>(func);
+}
+
+namespace swap_ns
+{
+
+using std::swap;
+template <typename Ret, typename... Args>
+inline void swap(function_ref<Ret(Args...)>& l, function_ref<Ret(Args...)>& r)
+{
+  l.swap(r);
+}
+
+} // namespace swap_ns
+} // namespace ak
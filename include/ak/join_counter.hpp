@@ -0,0 +1,415 @@
+// Copyright (C) 2021 Artem Komyshan
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+#include "ak/call_once_silent.hpp"
+
+/**
+ * @brief join_counter is a fan-in barrier: it hands out a fixed number of
+ * completions and invokes the callback once all of them are done, passing
+ * the results in the order the completions were made.
+ *
+ * ak::join_counter<int> join(requests.size(), [](auto results) {
+ *   for (auto& result : results)
+ *     if (result)
+ *       sum += *result;
+ * });
+ * for (auto& request : requests)
+ *   request.async_run(join.make_completion());
+ * join.release();
+ *
+ * The counter, the callback and the result slots live in a single block,
+ * which may be taken from an allocator. A completion is two pointers and
+ * completing is one store into its slot and one atomic decrement, so nothing
+ * is allocated per completion. A completion destroyed without being called
+ * counts as done and leaves its slot empty, as does the last copy of
+ * call_on_expire.
+ *
+ * The callback runs on the thread which finishes the last completion, or in
+ * release() when all completions are already done.
+ */
+
+namespace ak
+{
+
+/// The results of a join_counter<T>, valid while its callback runs.
+template <typename T>
+class join_results
+{
+public:
+  using value_type = std::optional<T>;
+  using iterator = value_type*;
+
+  join_results(value_type* first, std::size_t size) noexcept
+      : mFirst(first)
+      , mSize(size)
+  {
+  }
+
+  iterator begin() const noexcept
+  {
+    return mFirst;
+  }
+
+  iterator end() const noexcept
+  {
+    return mFirst + mSize;
+  }
+
+  std::size_t size() const noexcept
+  {
+    return mSize;
+  }
+
+  value_type& operator[](std::size_t index) const noexcept
+  {
+    return mFirst[index];
+  }
+
+private:
+  value_type* mFirst;
+  std::size_t mSize;
+};
+
+namespace detail
+{
+
+template <typename T>
+struct join_traits
+{
+  using slot = std::optional<T>;
+  using callback = call_once_silent<join_results<T>>;
+  static constexpr bool has_results = true;
+};
+
+template <>
+struct join_traits<void>
+{
+  struct slot
+  {
+  };
+  using callback = call_once_silent<>;
+  static constexpr bool has_results = false;
+};
+
+/**
+ * @brief join_state is the shared block of a join_counter. The issuer holds
+ * one arrival for itself and one for every completion not handed out yet.
+ */
+template <typename T>
+class join_state
+{
+public:
+  using slot_t = typename join_traits<T>::slot;
+  using callback_t = typename join_traits<T>::callback;
+  using destroy_t = void (*)(join_state*) noexcept;
+
+  join_state(std::size_t count, slot_t* slots, callback_t done,
+             destroy_t destroy) noexcept
+      : mRemaining(count + 1)
+      , mCount(count)
+      , mSlots(slots)
+      , mDone(std::move(done))
+      , mDestroy(destroy)
+  {
+  }
+
+  std::size_t size() const noexcept
+  {
+    return mCount;
+  }
+
+  slot_t& slot(std::size_t index) noexcept
+  {
+    return mSlots[index];
+  }
+
+  /// Counts \c n arrivals down, the last one runs the callback and destroys
+  /// the block.
+  void arrive(std::size_t n)
+  {
+    // release publishes the slot, the last arrival acquires all of them
+    if (mRemaining.fetch_sub(n, std::memory_order_acq_rel) != n)
+      return;
+
+    struct destroy_guard
+    {
+      ~destroy_guard()
+      {
+        state->mDestroy(state);
+      }
+
+      join_state* state;
+    } guard{this};
+
+    auto done = std::move(mDone);
+    if constexpr (join_traits<T>::has_results)
+      done(join_results<T>(mSlots, mCount));
+    else
+      done();
+  }
+
+private:
+  std::atomic<std::size_t> mRemaining;
+  std::size_t const mCount;
+  slot_t* const mSlots;
+  callback_t mDone;
+  destroy_t const mDestroy;
+};
+
+/// The block and its slots are allocated together with \c Alloc.
+template <typename T, typename Alloc>
+class join_state_for
+    : public join_state<T>
+    , Alloc
+{
+  using base = join_state<T>;
+  using slot_t = typename base::slot_t;
+  using callback_t = typename base::callback_t;
+
+  static constexpr std::size_t align =
+      std::max({alignof(base), alignof(Alloc), alignof(slot_t)});
+
+  struct alignas(align) unit
+  {
+    unsigned char bytes[align];
+  };
+
+  using alloc_t =
+      typename std::allocator_traits<Alloc>::template rebind_alloc<unit>;
+  using traits = std::allocator_traits<alloc_t>;
+
+  static std::size_t slot_count(std::size_t count) noexcept
+  {
+    return join_traits<T>::has_results ? count : 0;
+  }
+
+  static constexpr std::size_t slots_offset() noexcept
+  {
+    return (sizeof(join_state_for) + alignof(slot_t) - 1) / alignof(slot_t) *
+           alignof(slot_t);
+  }
+
+  static std::size_t units(std::size_t count) noexcept
+  {
+    return (slots_offset() + slot_count(count) * sizeof(slot_t) +
+            sizeof(unit) - 1) /
+           sizeof(unit);
+  }
+
+  static slot_t* slots(void* block) noexcept
+  {
+    return reinterpret_cast<slot_t*>(static_cast<unsigned char*>(block) +
+                                     slots_offset());
+  }
+
+  join_state_for(Alloc const& alloc, std::size_t count, slot_t* slots,
+                 callback_t done) noexcept
+      : base(count, slots, std::move(done), &destroy)
+      , Alloc(alloc)
+  {
+  }
+
+public:
+  static base* create(Alloc const& alloc, std::size_t count, callback_t done)
+  {
+    alloc_t a(alloc);
+    auto memory = traits::allocate(a, units(count));
+    void* block = std::addressof(*memory);
+
+    auto first = slots(block);
+    std::uninitialized_value_construct_n(first, slot_count(count));
+    return ::new (block) join_state_for(alloc, count, first, std::move(done));
+  }
+
+private:
+  static void destroy(base* state) noexcept
+  {
+    auto self = static_cast<join_state_for*>(state);
+    auto const count = self->size();
+    alloc_t a(static_cast<Alloc const&>(*self));
+
+    std::destroy_n(slots(self), slot_count(count));
+    self->~join_state_for();
+    traits::deallocate(a, reinterpret_cast<unit*>(self), units(count));
+  }
+};
+
+} // namespace detail
+
+template <typename T = void>
+class join_counter
+{
+  using state_t = detail::join_state<T>;
+
+public:
+  class completion;
+
+  join_counter() noexcept = default;
+
+  /// \c done is invoked with join_results<T>, or with nothing for void.
+  template <typename Func>
+  join_counter(std::size_t count, Func&& done)
+      : join_counter(std::allocator_arg, std::allocator<char>(), count,
+                     std::forward<Func>(done))
+  {
+  }
+
+  /// Takes the shared block and a big callback from \c alloc.
+  template <typename Alloc, typename Func>
+  join_counter(std::allocator_arg_t, Alloc const& alloc, std::size_t count,
+               Func&& done)
+      : mState(detail::join_state_for<T, Alloc>::create(
+            alloc, count,
+            typename state_t::callback_t(std::allocator_arg, alloc,
+                                         std::forward<Func>(done))))
+  {
+  }
+
+  join_counter(join_counter const&) = delete;
+  join_counter& operator=(join_counter const&) = delete;
+
+  join_counter(join_counter&& o) noexcept
+      : mState(std::exchange(o.mState, nullptr))
+      , mIssued(o.mIssued)
+  {
+  }
+
+  join_counter& operator=(join_counter&& o)
+  {
+    if (this != &o)
+      {
+        release();
+        mState = std::exchange(o.mState, nullptr);
+        mIssued = o.mIssued;
+      }
+    return *this;
+  }
+
+  ~join_counter()
+  {
+    release();
+  }
+
+  /// Hands out the next completion, its result goes to the slot of the same
+  /// index. At most \c count completions may be made.
+  completion make_completion() noexcept;
+
+  /// Gives up the completions not made yet. The callback runs once every
+  /// completion made so far is done.
+  void release();
+
+  /// The number of completions the counter was created for.
+  std::size_t size() const noexcept
+  {
+    return mState ? mState->size() : 0;
+  }
+
+  explicit operator bool() const noexcept
+  {
+    return mState != nullptr;
+  }
+
+private:
+  state_t* mState = nullptr;
+  std::size_t mIssued = 0;
+};
+
+template <typename T>
+class join_counter<T>::completion
+{
+public:
+  completion() noexcept = default;
+
+  completion(completion&& o) noexcept
+      : mState(std::exchange(o.mState, nullptr))
+      , mIndex(o.mIndex)
+  {
+  }
+
+  completion& operator=(completion&& o)
+  {
+    if (this != &o)
+      {
+        drop();
+        mState = std::exchange(o.mState, nullptr);
+        mIndex = o.mIndex;
+      }
+    return *this;
+  }
+
+  ~completion()
+  {
+    drop();
+  }
+
+  /// Stores the result constructed from \c values, later calls are ignored.
+  template <typename... Values>
+  void operator()(Values&&... values)
+  {
+    if (!mState)
+      return;
+
+    if constexpr (detail::join_traits<T>::has_results)
+      mState->slot(mIndex).emplace(std::forward<Values>(values)...);
+    else
+      static_assert(sizeof...(Values) == 0,
+                    "join_counter<void> completions take no result");
+
+    drop();
+  }
+
+  explicit operator bool() const noexcept
+  {
+    return mState != nullptr;
+  }
+
+private:
+  friend class join_counter;
+
+  completion(state_t* state, std::size_t index) noexcept
+      : mState(state)
+      , mIndex(index)
+  {
+  }
+
+  void drop()
+  {
+    if (auto state = std::exchange(mState, nullptr))
+      state->arrive(1);
+  }
+
+  state_t* mState = nullptr;
+  std::size_t mIndex = 0;
+};
+
+template <typename T>
+typename join_counter<T>::completion
+join_counter<T>::make_completion() noexcept
+{
+  assert(mState && mIssued < mState->size());
+  return completion(mState, mIssued++);
+}
+
+template <typename T>
+void join_counter<T>::release()
+{
+  if (auto state = std::exchange(mState, nullptr))
+    state->arrive(state->size() - mIssued + 1);
+}
+
+} // namespace ak
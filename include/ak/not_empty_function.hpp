@@ -7,11 +7,14 @@
 #pragma once
 
 #include <cassert>
+#include <cstddef>
 #include <functional>
+#include <memory>
 #include <type_traits>
 #include <utility>
 
 #include "ak/callable_type_traits.hpp"
+#include "ak/detail/function_storage.hpp"
 #include "ak/requires.hpp"
 
 /**
@@ -25,16 +28,31 @@
  * // It is the caller's job to make sure cb is valid function ( cb != nullptr)
  * void request(not_empty_function<void(int)> cb);
  *
+ * The target is stored inside of the object when it is not bigger than
+ * \c Capacity bytes, its alignment divides \c Align and its move constructor
+ * does not throw. Only bigger targets are allocated on the heap.
+ *
+ * // 64 bytes of captures are kept inline, no allocation
+ * std::array<char, 64> buf;
+ * not_empty_function<void(int), 64> cb = [buf](int) {};
+ *
+ * A target which is allocated can take its memory from an allocator, copies
+ * of the function allocate from the same allocator.
+ *
+ * not_empty_function<void(int)> cb(std::allocator_arg, alloc, big_lambda);
  */
 
 namespace ak
 {
 
-template <typename Signature>
+template <typename Signature,
+          std::size_t Capacity = default_function_capacity,
+          std::size_t Align = default_function_alignment>
 class not_empty_function;
 
-template <typename Ret, typename... Args>
-class not_empty_function<Ret(Args...)>
+template <typename Ret, typename... Args, std::size_t Capacity,
+          std::size_t Align>
+class not_empty_function<Ret(Args...), Capacity, Align>
 {
   template <typename Func,
             typename Ret2 = typename std::result_of<Func&(Args...)>::type>
@@ -42,7 +60,30 @@ class not_empty_function<Ret(Args...)>
   {
   };
 
+  using storage_t = detail::function_storage<Capacity, Align>;
+
+  struct vtable
+  {
+    Ret (*invoke)(storage_t&, Args&&...);
+    void (*copy)(storage_t const&, storage_t&);
+    void (*move)(storage_t&, storage_t&) noexcept;
+    void (*destroy)(storage_t&) noexcept;
+  };
+
+  void destroy() noexcept;
+
+  template <typename Func, typename Alloc = std::allocator<char>>
+  struct vtable_for;
+
+  struct moved_from;
+
 public:
+  /// True when a target of type \c Func is stored without heap allocation.
+  template <typename Func>
+  static constexpr bool fits_inline =
+      detail::is_inline_storable<typename std::decay<Func>::type, Capacity,
+                                 Align>::value;
+
   explicit operator bool() const;
 
   Ret operator()(Args... args) const;
@@ -52,12 +93,14 @@ public:
   not_empty_function(std::nullptr_t) = delete;
   not_empty_function& operator=(std::nullptr_t) = delete;
 
-  /// Copy on move, since default implemetation clears source object.
-  not_empty_function(not_empty_function&& other);
-  not_empty_function& operator=(not_empty_function&& other);
+  /// Move steals the target and leaves the source with a shared stub which
+  /// asserts and throws std::bad_function_call if it is ever called, so the
+  /// moved-from object still compares unequal to nullptr.
+  not_empty_function(not_empty_function&& other) noexcept;
+  not_empty_function& operator=(not_empty_function&& other) noexcept;
 
-  not_empty_function(const not_empty_function& other) = default;
-  not_empty_function& operator=(const not_empty_function& other) = default;
+  not_empty_function(const not_empty_function& other);
+  not_empty_function& operator=(const not_empty_function& other);
 
   template <typename Func,
             typename = Requires<Not<std::is_same<
@@ -65,96 +108,232 @@ public:
             typename = Requires<Callable<Func>>>
   not_empty_function(Func&& call);
 
+  /// Allocates the target with \c alloc when it does not fit inline.
+  template <typename Alloc, typename Func,
+            typename = Requires<Not<std::is_same<
+                typename std::decay<Func>::type, not_empty_function>>>,
+            typename = Requires<Callable<Func>>>
+  not_empty_function(std::allocator_arg_t, Alloc const& alloc, Func&& call);
+
   template <typename Func,
             typename = Requires<Not<std::is_same<
                 typename std::decay<Func>::type, not_empty_function>>>,
             typename = Requires<Callable<Func>>>
   not_empty_function& operator=(Func&& call);
 
-  void swap(not_empty_function& other);
+  ~not_empty_function();
+
+  void swap(not_empty_function& other) noexcept;
 
 private:
-  std::function<Ret(Args...)> mCall;
+  vtable const* mVTable;
+  mutable storage_t mStorage;
+};
+
+template <typename Ret, typename... Args, std::size_t Capacity,
+          std::size_t Align>
+template <typename Func, typename Alloc>
+struct not_empty_function<Ret(Args...), Capacity, Align>::vtable_for
+{
+  using manager =
+      detail::storage_manager<Func, storage_t, fits_inline<Func>, Alloc>;
+
+  static Ret invoke(storage_t& storage, Args&&... args)
+  {
+    // std::invoke keeps pointers to members callable
+    if constexpr (std::is_void<Ret>::value)
+      std::invoke(manager::get(storage), std::forward<Args>(args)...);
+    else
+      return std::invoke(manager::get(storage), std::forward<Args>(args)...);
+  }
+
+  static constexpr vtable value = {
+      &invoke, manager::trivially_copyable ? nullptr : &manager::copy,
+      manager::trivially_relocatable ? nullptr : &manager::move,
+      manager::trivially_destructible ? nullptr : &manager::destroy};
+};
+
+template <typename Ret, typename... Args, std::size_t Capacity,
+          std::size_t Align>
+struct not_empty_function<Ret(Args...), Capacity, Align>::moved_from
+{
+  static Ret invoke(storage_t&, Args&&...)
+  {
+    assert(!"not_empty_function is called after move");
+    throw std::bad_function_call();
+  }
+
+  static constexpr vtable value = {&invoke, nullptr, nullptr, nullptr};
 };
 
-template <typename Ret, typename... Args>
-not_empty_function<Ret(Args...)>::not_empty_function(not_empty_function&& other)
-    : mCall(other.mCall)
+template <typename Ret, typename... Args, std::size_t Capacity,
+          std::size_t Align>
+not_empty_function<Ret(Args...), Capacity, Align>::not_empty_function(
+    not_empty_function&& other) noexcept
+    : mVTable(other.mVTable)
+{
+  detail::relocate(mVTable->move, other.mStorage, mStorage);
+  other.mVTable = &moved_from::value;
+}
+
+template <typename Ret, typename... Args, std::size_t Capacity,
+          std::size_t Align>
+not_empty_function<Ret(Args...), Capacity, Align>&
+not_empty_function<Ret(Args...), Capacity, Align>::operator=(
+    not_empty_function&& other) noexcept
+{
+  if (this != &other)
+    {
+      destroy();
+      mVTable = other.mVTable;
+      detail::relocate(mVTable->move, other.mStorage, mStorage);
+      other.mVTable = &moved_from::value;
+    }
+  return *this;
+}
+
+template <typename Ret, typename... Args, std::size_t Capacity,
+          std::size_t Align>
+not_empty_function<Ret(Args...), Capacity, Align>::not_empty_function(
+    const not_empty_function& other)
+    : mVTable(other.mVTable)
 {
-  assert(mCall);
+  detail::copy(mVTable->copy, other.mStorage, mStorage);
 }
 
-template <typename Ret, typename... Args>
-not_empty_function<Ret(Args...)>&
-not_empty_function<Ret(Args...)>::operator=(not_empty_function&& other)
+template <typename Ret, typename... Args, std::size_t Capacity,
+          std::size_t Align>
+not_empty_function<Ret(Args...), Capacity, Align>&
+not_empty_function<Ret(Args...), Capacity, Align>::operator=(
+    const not_empty_function& other)
 {
-  mCall = other.mCall;
-  assert(mCall);
+  if (this != &other)
+    {
+      not_empty_function tmp(other);
+      swap(tmp);
+    }
   return *this;
 }
 
-template <typename Ret, typename... Args>
+template <typename Ret, typename... Args, std::size_t Capacity,
+          std::size_t Align>
 template <typename Func, typename, typename>
-not_empty_function<Ret(Args...)>::not_empty_function(Func&& call)
-    : mCall(std::forward<Func>(call))
+not_empty_function<Ret(Args...), Capacity, Align>::not_empty_function(
+    Func&& call)
+    : mVTable(&vtable_for<typename std::decay<Func>::type>::value)
 {
-  assert(mCall);
+  if constexpr (std::is_constructible<bool, Func const&>::value)
+    assert(static_cast<bool>(call));
+
+  using manager = typename vtable_for<typename std::decay<Func>::type>::manager;
+  manager::create(mStorage, std::allocator<char>(), std::forward<Func>(call));
 }
 
-template <typename Ret, typename... Args>
+template <typename Ret, typename... Args, std::size_t Capacity,
+          std::size_t Align>
+template <typename Alloc, typename Func, typename, typename>
+not_empty_function<Ret(Args...), Capacity, Align>::not_empty_function(
+    std::allocator_arg_t, Alloc const& alloc, Func&& call)
+    : mVTable(&vtable_for<typename std::decay<Func>::type, Alloc>::value)
+{
+  if constexpr (std::is_constructible<bool, Func const&>::value)
+    assert(static_cast<bool>(call));
+
+  using manager =
+      typename vtable_for<typename std::decay<Func>::type, Alloc>::manager;
+  manager::create(mStorage, alloc, std::forward<Func>(call));
+}
+
+template <typename Ret, typename... Args, std::size_t Capacity,
+          std::size_t Align>
 template <typename Func, typename, typename>
-not_empty_function<Ret(Args...)>&
-not_empty_function<Ret(Args...)>::operator=(Func&& call)
+not_empty_function<Ret(Args...), Capacity, Align>&
+not_empty_function<Ret(Args...), Capacity, Align>::operator=(Func&& call)
 {
-  mCall = std::forward<Func>(call);
-  assert(mCall);
+  not_empty_function tmp(std::forward<Func>(call));
+  swap(tmp);
   return *this;
 }
 
-template <typename Ret, typename... Args>
-not_empty_function<Ret(Args...)>::operator bool() const
+template <typename Ret, typename... Args, std::size_t Capacity,
+          std::size_t Align>
+not_empty_function<Ret(Args...), Capacity, Align>::~not_empty_function()
 {
-  assert(mCall);
+  destroy();
+}
+
+template <typename Ret, typename... Args, std::size_t Capacity,
+          std::size_t Align>
+void not_empty_function<Ret(Args...), Capacity, Align>::destroy() noexcept
+{
+  if (mVTable->destroy)
+    mVTable->destroy(mStorage);
+}
+
+template <typename Ret, typename... Args, std::size_t Capacity,
+          std::size_t Align>
+not_empty_function<Ret(Args...), Capacity, Align>::operator bool() const
+{
+  assert(mVTable);
   return true;
 }
 
-template <typename Ret, typename... Args>
-Ret not_empty_function<Ret(Args...)>::operator()(Args... args) const
+template <typename Ret, typename... Args, std::size_t Capacity,
+          std::size_t Align>
+Ret not_empty_function<Ret(Args...), Capacity, Align>::operator()(
+    Args... args) const
 {
-  assert(mCall);
-  return mCall(std::forward<Args>(args)...);
+  assert(mVTable);
+  return mVTable->invoke(mStorage, std::forward<Args>(args)...);
 }
 
-template <typename Ret, typename... Args>
-void not_empty_function<Ret(Args...)>::swap(not_empty_function& other)
+template <typename Ret, typename... Args, std::size_t Capacity,
+          std::size_t Align>
+void not_empty_function<Ret(Args...), Capacity, Align>::swap(
+    not_empty_function& other) noexcept
 {
-  std::swap(mCall, other.mCall);
+  if (this == &other)
+    return;
+
+  storage_t tmp;
+  detail::relocate(mVTable->move, mStorage, tmp);
+  detail::relocate(other.mVTable->move, other.mStorage, mStorage);
+  detail::relocate(mVTable->move, tmp, other.mStorage);
+  std::swap(mVTable, other.mVTable);
 }
 
-template <typename Ret, typename... Args>
-inline bool operator==(const not_empty_function<Ret(Args...)>& func,
-                       std::nullptr_t) noexcept
+template <typename Ret, typename... Args, std::size_t Capacity,
+          std::size_t Align>
+inline bool
+operator==(const not_empty_function<Ret(Args...), Capacity, Align>& func,
+           std::nullptr_t) noexcept
 {
   return !static_cast<bool>(func);
 }
 
-template <typename Ret, typename... Args>
-inline bool operator==(std::nullptr_t,
-                       const not_empty_function<Ret(Args...)>& func) noexcept
+template <typename Ret, typename... Args, std::size_t Capacity,
+          std::size_t Align>
+inline bool operator==(
+    std::nullptr_t,
+    const not_empty_function<Ret(Args...), Capacity, Align>& func) noexcept
 {
   return !static_cast<bool>(func);
 }
 
-template <typename Ret, typename... Args>
-inline bool operator!=(const not_empty_function<Ret(Args...)>& func,
-                       std::nullptr_t) noexcept
+template <typename Ret, typename... Args, std::size_t Capacity,
+          std::size_t Align>
+inline bool
+operator!=(const not_empty_function<Ret(Args...), Capacity, Align>& func,
+           std::nullptr_t) noexcept
 {
   return static_cast<bool>(func);
 }
 
-template <typename Ret, typename... Args>
-inline bool operator!=(std::nullptr_t,
-                       const not_empty_function<Ret(Args...)>& func) noexcept
+template <typename Ret, typename... Args, std::size_t Capacity,
+          std::size_t Align>
+inline bool operator!=(
+    std::nullptr_t,
+    const not_empty_function<Ret(Args...), Capacity, Align>& func) noexcept
 {
   return static_cast<bool>(func);
 }
@@ -163,9 +342,10 @@ namespace swap_ns
 {
 
 using std::swap;
-template <typename Ret, typename... Args>
-inline void swap(not_empty_function<Ret(Args...)>& l,
-                 not_empty_function<Ret(Args...)>& r)
+template <typename Ret, typename... Args, std::size_t Capacity,
+          std::size_t Align>
+inline void swap(not_empty_function<Ret(Args...), Capacity, Align>& l,
+                 not_empty_function<Ret(Args...), Capacity, Align>& r)
 {
   l.swap(r);
 }
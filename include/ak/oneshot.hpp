@@ -0,0 +1,404 @@
+// Copyright (C) 2021 Artem Komyshan
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+#include "ak/call_once_silent.hpp"
+#include "ak/detail/function_storage.hpp"
+
+/**
+ * @brief oneshot is a channel which carries a single value from a sender to
+ * a receiver, a lightweight replacement of std::promise and std::future.
+ *
+ * auto [sender, receiver] = ak::oneshot<response>();
+ * request.async_run(std::move(sender));
+ * receiver.then([](std::optional<response> r) { ... });
+ * // or
+ * auto r = receiver.wait();
+ *
+ * The sender is a callable with the first-call-wins claim of
+ * concurrent_call_once_silent, so it may be passed wherever a
+ * call_once_silent<T> callback is expected. The receiver gets std::nullopt if
+ * the sender is destroyed without being called.
+ *
+ * The value and the continuation live in a single block, which may be taken
+ * from an allocator. Both sides meet on one atomic word: neither a value sent
+ * to a continuation nor a continuation set after the value takes a lock. Only
+ * a blocking wait parks on a mutex and a condition variable, those are shared
+ * by all channels.
+ */
+
+namespace ak
+{
+
+namespace detail
+{
+
+/// Channels which block in wait() are spread over a few shared parking spots.
+struct oneshot_parking
+{
+  static constexpr std::size_t size = 16;
+
+  static oneshot_parking& of(void const* state) noexcept
+  {
+    // intentionally leaked, a channel may be used during static destruction
+    static auto* spots = new oneshot_parking[size];
+    auto const key = reinterpret_cast<std::uintptr_t>(state);
+    return spots[(key >> 6) % size];
+  }
+
+  std::mutex mutex;
+  std::condition_variable condition;
+};
+
+template <typename T>
+struct oneshot_state
+{
+  using destroy_t = void (*)(oneshot_state*) noexcept;
+  using continuation_t = call_once_silent<std::optional<T>>;
+
+  /// The value is written and the sender is gone.
+  static constexpr unsigned char ready = 1;
+  /// The continuation is set and the receiver is gone.
+  static constexpr unsigned char attached = 2;
+  /// The receiver is blocked in wait().
+  static constexpr unsigned char waiting = 4;
+
+  explicit oneshot_state(destroy_t d) noexcept : destroy(d) {}
+
+  /// Moves the result to the continuation and gives up the block, the side
+  /// which sets the second of ready and attached calls it.
+  void finish()
+  {
+    auto value = std::move(this->value);
+    auto func = std::move(continuation);
+    destroy(this);
+    func(std::move(value));
+  }
+
+  std::atomic<unsigned char> flags{0};
+  std::optional<T> value;
+  continuation_t continuation;
+  destroy_t const destroy;
+};
+
+template <typename T, typename Alloc>
+struct oneshot_state_for
+    : oneshot_state<T>
+    , Alloc
+{
+  using base = oneshot_state<T>;
+
+  explicit oneshot_state_for(Alloc const& alloc)
+      : base(&destroy_state)
+      , Alloc(alloc)
+  {
+  }
+
+  static void destroy_state(base* state) noexcept
+  {
+    auto self = static_cast<oneshot_state_for*>(state);
+    deallocate_object(Alloc(static_cast<Alloc const&>(*self)), self);
+  }
+};
+
+} // namespace detail
+
+template <typename T>
+class oneshot_sender
+{
+  using state_t = detail::oneshot_state<T>;
+
+public:
+  oneshot_sender() noexcept = default;
+
+  explicit oneshot_sender(state_t* state) noexcept
+      : mState(state)
+      , mClaimed(state == nullptr)
+  {
+  }
+
+  oneshot_sender(oneshot_sender const&) = delete;
+  oneshot_sender& operator=(oneshot_sender const&) = delete;
+
+  /// Moving is not synchronized with concurrent calls.
+  oneshot_sender(oneshot_sender&& o) noexcept
+      : oneshot_sender(o.release())
+  {
+  }
+
+  oneshot_sender& operator=(oneshot_sender&& o)
+  {
+    if (this != &o)
+      {
+        reset();
+        mState = o.release();
+        mClaimed.store(mState == nullptr, std::memory_order_relaxed);
+      }
+    return *this;
+  }
+
+  ~oneshot_sender()
+  {
+    reset();
+  }
+
+  /// Sends the value constructed from \c values, may be called from several
+  /// threads at once. The first call wins, the others are ignored.
+  template <typename... Values>
+  void operator()(Values&&... values)
+  {
+    // only the winner of the exchange touches the state
+    if (mClaimed.load(std::memory_order_relaxed) ||
+        mClaimed.exchange(true, std::memory_order_acquire))
+      return;
+
+    try
+      {
+        mState->value.emplace(std::forward<Values>(values)...);
+      }
+    catch (...)
+      {
+        send();
+        throw;
+      }
+    send();
+  }
+
+  explicit operator bool() const
+  {
+    return !mClaimed.load(std::memory_order_acquire);
+  }
+
+private:
+  state_t* release() noexcept
+  {
+    if (mClaimed.exchange(true, std::memory_order_acquire))
+      return nullptr;
+    return std::exchange(mState, nullptr);
+  }
+
+  /// The receiver gets std::nullopt if nothing was sent.
+  void reset()
+  {
+    if (!mClaimed.exchange(true, std::memory_order_acquire))
+      send();
+  }
+
+  void send()
+  {
+    auto const state = std::exchange(mState, nullptr);
+    auto const flags =
+        state->flags.fetch_or(state_t::ready, std::memory_order_acq_rel);
+    if (flags & state_t::attached)
+      state->finish();
+    else if (flags & state_t::waiting)
+      {
+        // the receiver may have freed the block already, only its address is
+        // used to find the parking spot; taking the mutex orders the
+        // notification after the receiver's check
+        auto& parking = detail::oneshot_parking::of(state);
+        {
+          std::lock_guard<std::mutex> lock(parking.mutex);
+        }
+        parking.condition.notify_all();
+      }
+  }
+
+  state_t* mState = nullptr;
+  std::atomic<bool> mClaimed{true};
+};
+
+template <typename T>
+class oneshot_receiver
+{
+  using state_t = detail::oneshot_state<T>;
+
+public:
+  oneshot_receiver() noexcept = default;
+
+  explicit oneshot_receiver(state_t* state) noexcept : mState(state) {}
+
+  oneshot_receiver(oneshot_receiver const&) = delete;
+  oneshot_receiver& operator=(oneshot_receiver const&) = delete;
+
+  oneshot_receiver(oneshot_receiver&& o) noexcept
+      : mState(std::exchange(o.mState, nullptr))
+  {
+  }
+
+  oneshot_receiver& operator=(oneshot_receiver&& o)
+  {
+    if (this != &o)
+      {
+        then(nullptr);
+        mState = std::exchange(o.mState, nullptr);
+      }
+    return *this;
+  }
+
+  /// The value is dropped when it arrives.
+  ~oneshot_receiver()
+  {
+    then(nullptr);
+  }
+
+  /**
+   * @brief then hands the receiver over to \c func, which is invoked with the
+   * result on the sending thread, or right away if it has already arrived.
+   */
+  template <typename Func>
+  void then(Func&& func);
+
+  /// Blocks until the result arrives and takes it.
+  std::optional<T> wait();
+
+  /// True if wait() would not block.
+  bool ready() const noexcept
+  {
+    return mState &&
+           (mState->flags.load(std::memory_order_acquire) & state_t::ready);
+  }
+
+  explicit operator bool() const noexcept
+  {
+    return mState != nullptr;
+  }
+
+private:
+  state_t* mState = nullptr;
+};
+
+template <typename T>
+template <typename Func>
+void oneshot_receiver<T>::then(Func&& func)
+{
+  if (!mState)
+    return;
+
+  typename state_t::continuation_t continuation(std::forward<Func>(func));
+  auto const state = std::exchange(mState, nullptr);
+  state->continuation = std::move(continuation);
+  if (state->flags.fetch_or(state_t::attached, std::memory_order_acq_rel) &
+      state_t::ready)
+    state->finish();
+}
+
+template <typename T>
+std::optional<T> oneshot_receiver<T>::wait()
+{
+  auto const state = std::exchange(mState, nullptr);
+  if (!state)
+    throw std::bad_function_call();
+
+  if (!(state->flags.load(std::memory_order_acquire) & state_t::ready) &&
+      !(state->flags.fetch_or(state_t::waiting, std::memory_order_acq_rel) &
+        state_t::ready))
+    {
+      auto& parking = detail::oneshot_parking::of(state);
+      std::unique_lock<std::mutex> lock(parking.mutex);
+      parking.condition.wait(lock, [state] {
+        return state->flags.load(std::memory_order_acquire) & state_t::ready;
+      });
+    }
+
+  auto value = std::move(state->value);
+  state->destroy(state);
+  return value;
+}
+
+/// The sending and the receiving side of one channel.
+template <typename T>
+struct oneshot
+{
+  static_assert(!std::is_void<T>::value && !std::is_reference<T>::value,
+                "oneshot carries an object");
+
+  oneshot()
+      : oneshot(std::allocator_arg, std::allocator<char>())
+  {
+  }
+
+  /// Takes the shared block from \c alloc.
+  template <typename Alloc>
+  oneshot(std::allocator_arg_t, Alloc const& alloc)
+      : oneshot(detail::allocate_object<detail::oneshot_state_for<T, Alloc>>(
+            alloc, alloc))
+  {
+  }
+
+  oneshot_sender<T> sender;
+  oneshot_receiver<T> receiver;
+
+private:
+  explicit oneshot(detail::oneshot_state<T>* state) noexcept
+      : sender(state)
+      , receiver(state)
+  {
+  }
+};
+
+// null pointer comparisons
+template <typename T>
+bool operator==(oneshot_sender<T> const& sender, std::nullptr_t) noexcept
+{
+  return !static_cast<bool>(sender);
+}
+
+template <typename T>
+bool operator==(std::nullptr_t, oneshot_sender<T> const& sender) noexcept
+{
+  return !static_cast<bool>(sender);
+}
+
+template <typename T>
+bool operator!=(oneshot_sender<T> const& sender, std::nullptr_t) noexcept
+{
+  return static_cast<bool>(sender);
+}
+
+template <typename T>
+bool operator!=(std::nullptr_t, oneshot_sender<T> const& sender) noexcept
+{
+  return static_cast<bool>(sender);
+}
+
+template <typename T>
+bool operator==(oneshot_receiver<T> const& receiver, std::nullptr_t) noexcept
+{
+  return !static_cast<bool>(receiver);
+}
+
+template <typename T>
+bool operator==(std::nullptr_t, oneshot_receiver<T> const& receiver) noexcept
+{
+  return !static_cast<bool>(receiver);
+}
+
+template <typename T>
+bool operator!=(oneshot_receiver<T> const& receiver, std::nullptr_t) noexcept
+{
+  return static_cast<bool>(receiver);
+}
+
+template <typename T>
+bool operator!=(std::nullptr_t, oneshot_receiver<T> const& receiver) noexcept
+{
+  return static_cast<bool>(receiver);
+}
+
+} // namespace ak
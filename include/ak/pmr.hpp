@@ -0,0 +1,136 @@
+// Copyright (C) 2021 Artem Komyshan
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <type_traits>
+#include <utility>
+
+#include "ak/call_on_expire.hpp"
+#include "ak/call_once_silent.hpp"
+#include "ak/not_empty_function.hpp"
+#include "ak/requires.hpp"
+#include "ak/shared_function.hpp"
+
+/**
+ * The ak::pmr wrappers take every allocation from a memory resource: from
+ * std::pmr::get_default_resource() unless an allocator is given, just as the
+ * std::pmr containers do.
+ *
+ * std::pmr::monotonic_buffer_resource arena;
+ * std::pmr::set_default_resource(&arena);
+ * ak::pmr::shared_function<void()> cb = lambda;  // the block is in the arena
+ * ak::pmr::shared_function<void()> other(std::allocator_arg,
+ *                                        ak::pmr::allocator(&heap), lambda);
+ *
+ * The wrappers keep the allocator of the target next to it, so a pmr wrapper
+ * is derived from the plain one and adds nothing but constructors. Functions
+ * built on an arena can be passed anywhere a plain wrapper is expected.
+ */
+
+namespace ak
+{
+namespace pmr
+{
+
+using allocator = std::pmr::polymorphic_allocator<std::byte>;
+
+namespace detail
+{
+
+/// \c Base whose targets come from the default resource unless an allocator
+/// is given.
+template <typename Base>
+class wrapper : public Base
+{
+  template <typename T>
+  using not_wrapper = Requires<And<
+      Not<std::is_base_of<Base, typename std::decay<T>::type>>,
+      Not<std::is_same<typename std::decay<T>::type, std::nullptr_t>>,
+      Not<std::is_same<typename std::decay<T>::type, std::allocator_arg_t>>>>;
+
+public:
+  wrapper() = default;
+
+  wrapper(std::nullptr_t) noexcept
+      : Base(nullptr)
+  {
+  }
+
+  wrapper(Base const& o)
+      : Base(o)
+  {
+  }
+
+  wrapper(Base&& o) noexcept
+      : Base(std::move(o))
+  {
+  }
+
+  template <typename Func, typename = not_wrapper<Func>>
+  wrapper(Func&& func)
+      : Base(std::allocator_arg, allocator(), std::forward<Func>(func))
+  {
+  }
+
+  /// E.g. call_on_expire(executor, func).
+  template <typename First, typename Second, typename... Rest,
+            typename = not_wrapper<First>>
+  wrapper(First&& first, Second&& second, Rest&&... rest)
+      : Base(std::allocator_arg, allocator(), std::forward<First>(first),
+             std::forward<Second>(second), std::forward<Rest>(rest)...)
+  {
+  }
+
+  template <typename Alloc, typename... CArgs>
+  wrapper(std::allocator_arg_t, Alloc const& alloc, CArgs&&... args)
+      : Base(std::allocator_arg, alloc, std::forward<CArgs>(args)...)
+  {
+  }
+
+  template <typename Func, typename = not_wrapper<Func>>
+  wrapper& operator=(Func&& func)
+  {
+    Base::operator=(wrapper(std::forward<Func>(func)));
+    return *this;
+  }
+
+  wrapper& operator=(std::nullptr_t)
+  {
+    Base::operator=(nullptr);
+    return *this;
+  }
+};
+
+} // namespace detail
+
+template <typename Signature,
+          std::size_t Capacity = default_function_capacity,
+          std::size_t Align = default_function_alignment>
+using not_empty_function =
+    detail::wrapper<ak::not_empty_function<Signature, Capacity, Align>>;
+
+template <typename Signature>
+using shared_function = detail::wrapper<ak::shared_function<Signature>>;
+
+template <typename Signature>
+using local_shared_function =
+    detail::wrapper<ak::local_shared_function<Signature>>;
+
+template <typename... Args>
+using call_once_silent = detail::wrapper<ak::call_once_silent<Args...>>;
+
+template <typename... Args>
+using concurrent_call_once_silent =
+    detail::wrapper<ak::concurrent_call_once_silent<Args...>>;
+
+using call_on_expire = detail::wrapper<ak::call_on_expire>;
+
+} // namespace pmr
+} // namespace ak
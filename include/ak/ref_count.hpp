@@ -0,0 +1,292 @@
+// Copyright (C) 2020 Artem Komyshan
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+/**
+ * Reference counting policies of the shared wrappers. A policy starts with
+ * one reference, add_ref() takes one more and release() returns true when the
+ * last reference is dropped. bind() gives the policy a way to destroy the
+ * object itself, for a policy which may learn about the last reference later
+ * than the release() which dropped it.
+ */
+
+namespace ak
+{
+
+/// Thread-safe counter, copies may be created and destroyed concurrently.
+class atomic_ref_count
+{
+public:
+  void add_ref() noexcept
+  {
+    mCount.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  bool release() noexcept
+  {
+    return mCount.fetch_sub(1, std::memory_order_acq_rel) == 1;
+  }
+
+  void bind(void (*)(void*) noexcept, void*) noexcept {}
+
+private:
+  std::atomic<std::size_t> mCount{1};
+};
+
+/// Plain counter for objects which never leave a single thread.
+class local_ref_count
+{
+public:
+  void add_ref() noexcept
+  {
+    ++mCount;
+  }
+
+  bool release() noexcept
+  {
+    return --mCount == 0;
+  }
+
+  void bind(void (*)(void*) noexcept, void*) noexcept {}
+
+private:
+  std::size_t mCount = 1;
+};
+
+class biased_ref_count;
+
+namespace detail
+{
+
+/// The thread which created biased counters, it merges their halves.
+struct biased_owner
+{
+  std::mutex mutex;
+  biased_ref_count* pending = nullptr;
+  std::atomic<bool> has_pending{false};
+  bool alive = true;
+};
+
+} // namespace detail
+
+/**
+ * @brief Thread-safe counter biased towards the thread which created it.
+ *
+ * The owner thread counts its references with a plain integer, other threads
+ * use an atomic one, so copies made and dropped by the owner never touch a
+ * shared cache line. When the owner drops its last reference the halves are
+ * merged and the counter becomes a plain atomic one.
+ *
+ * Another thread may drop a reference counted by the owner. If the atomic
+ * half goes below zero the counter is queued to the owner, which merges it
+ * on its next release(), in merge_pending() or when the owner thread exits.
+ * Until then the object may stay alive after its last reference is gone.
+ */
+class biased_ref_count
+{
+  static constexpr std::int64_t merged = 1;
+  static constexpr std::int64_t queued = 2;
+  static constexpr std::int64_t one = 4;
+
+public:
+  biased_ref_count()
+      : mOwner(local_owner())
+  {
+  }
+
+  void add_ref() noexcept
+  {
+    if (is_owner() && mBiased > 0)
+      ++mBiased;
+    else
+      mShared.fetch_add(one, std::memory_order_relaxed);
+  }
+
+  bool release() noexcept;
+
+  void bind(void (*destroy)(void*) noexcept, void* object) noexcept
+  {
+    mDestroy = destroy;
+    mObject = object;
+  }
+
+  /// Merges the counters queued to the calling thread, event loops of long
+  /// living threads may call it to release objects in time.
+  static void merge_pending() noexcept;
+
+private:
+  struct owner_holder
+  {
+    owner_holder()
+        : owner(std::make_shared<detail::biased_owner>())
+    {
+    }
+
+    ~owner_holder();
+
+    std::shared_ptr<detail::biased_owner> owner;
+  };
+
+  static owner_holder& holder()
+  {
+    thread_local owner_holder self;
+    return self;
+  }
+
+  static std::shared_ptr<detail::biased_owner> const& local_owner()
+  {
+    return holder().owner;
+  }
+
+  bool is_owner() const noexcept
+  {
+    return mOwner.get() == local_owner().get();
+  }
+
+  static std::int64_t count(std::int64_t shared) noexcept
+  {
+    return shared >> 2;
+  }
+
+  void enqueue() noexcept;
+
+  // adds the owner's half to the shared one, destroys the object if it was
+  // the last reference
+  void merge() noexcept;
+
+  static void merge_list(biased_ref_count* list) noexcept;
+
+  // read-only fields, the owner's half and the shared half are kept on
+  // different cache lines
+  std::shared_ptr<detail::biased_owner> mOwner;
+  void (*mDestroy)(void*) noexcept = nullptr;
+  void* mObject = nullptr;
+  // accessed by the owner thread only while it is alive
+  alignas(64) std::size_t mBiased = 1;
+  alignas(64) std::atomic<std::int64_t> mShared{0};
+  biased_ref_count* mNextPending = nullptr;
+};
+
+inline bool biased_ref_count::release() noexcept
+{
+  if (is_owner())
+    {
+      // this counter may be merged as well
+      if (mOwner->has_pending.load(std::memory_order_relaxed))
+        merge_pending();
+
+      if (mBiased > 0)
+        {
+          if (--mBiased > 0)
+            return false;
+
+          // implicit merge, from now on every thread counts atomically
+          auto const old = mShared.fetch_or(merged, std::memory_order_acq_rel);
+          return !(old & queued) && count(old) == 0;
+        }
+    }
+
+  auto old = mShared.load(std::memory_order_relaxed);
+  std::int64_t desired;
+  do
+    {
+      desired = old - one;
+      if (!(old & merged) && !(old & queued) && count(desired) < 0)
+        desired |= queued;
+    }
+  while (!mShared.compare_exchange_weak(old, desired,
+                                        std::memory_order_acq_rel,
+                                        std::memory_order_relaxed));
+
+  if ((desired & queued) && !(old & queued))
+    {
+      enqueue();
+      return false;
+    }
+
+  // a queued counter is destroyed by merge()
+  return (desired & merged) && !(desired & queued) && count(desired) == 0;
+}
+
+inline void biased_ref_count::enqueue() noexcept
+{
+  auto& owner = *mOwner;
+  {
+    std::lock_guard<std::mutex> lock(owner.mutex);
+    if (owner.alive)
+      {
+        mNextPending = owner.pending;
+        owner.pending = this;
+        owner.has_pending.store(true, std::memory_order_relaxed);
+        return;
+      }
+  }
+
+  // the owner is gone, its half doesn't change anymore
+  merge();
+}
+
+inline void biased_ref_count::merge() noexcept
+{
+  auto const biased = static_cast<std::int64_t>(mBiased);
+  mBiased = 0;
+
+  auto old = mShared.load(std::memory_order_relaxed);
+  std::int64_t desired;
+  do
+    desired = ((old + biased * one) | merged) & ~queued;
+  while (!mShared.compare_exchange_weak(old, desired,
+                                        std::memory_order_acq_rel,
+                                        std::memory_order_relaxed));
+
+  if (count(desired) == 0)
+    mDestroy(mObject);
+}
+
+inline void biased_ref_count::merge_list(biased_ref_count* list) noexcept
+{
+  while (list)
+    {
+      // merge() may destroy the counter
+      auto const next = list->mNextPending;
+      list->merge();
+      list = next;
+    }
+}
+
+inline void biased_ref_count::merge_pending() noexcept
+{
+  auto& owner = *local_owner();
+  biased_ref_count* list;
+  {
+    std::lock_guard<std::mutex> lock(owner.mutex);
+    list = owner.pending;
+    owner.pending = nullptr;
+    owner.has_pending.store(false, std::memory_order_relaxed);
+  }
+  merge_list(list);
+}
+
+inline biased_ref_count::owner_holder::~owner_holder()
+{
+  biased_ref_count* list;
+  {
+    std::lock_guard<std::mutex> lock(owner->mutex);
+    owner->alive = false;
+    list = owner->pending;
+    owner->pending = nullptr;
+  }
+  merge_list(list);
+}
+
+} // namespace ak
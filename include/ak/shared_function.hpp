@@ -6,45 +6,152 @@
 
 #pragma once
 
+#include <cstddef>
 #include <functional>
 #include <memory>
 #include <type_traits>
 #include <utility>
 
+#include "ak/callable_type_traits.hpp"
+#include "ak/detail/function_storage.hpp"
+#include "ak/ref_count.hpp"
 #include "ak/requires.hpp"
 
 /**
  * shared_function is a polymorphic function wrapper
  * that retains shared ownership of a function through a shared pointer.
  * Several shared_function objects may own the same object.
+ *
+ * The target is stored in a single heap block right next to its reference
+ * counter and the pointer to the invoker, so the construction allocates once
+ * and the call is a single indirect call.
+ *
+ * Captureless lambdas and plain function pointers have nothing to share: they
+ * are stored in the object itself, with no allocation and no reference
+ * counting.
+ *
+ * RefCount selects how copies are counted: atomic_ref_count (default) allows
+ * copies to be shared between threads, local_shared_function uses a plain
+ * counter for single-threaded code and biased_shared_function lets the thread
+ * which made the function copy it without atomic operations.
+ *
+ * The block may be taken from an allocator, it is given back to a copy of the
+ * same allocator when the last owner is gone.
+ *
+ * shared_function<void()> cb(std::allocator_arg, alloc, lambda);
  */
 
 namespace ak
 {
 
-template <typename Signature>
+namespace detail
+{
+
+template <typename RefCount, typename Ret, typename... Args>
+struct shared_function_block
+{
+  using invoke_t = Ret (*)(shared_function_block*, Args&&...);
+  using destroy_t = void (*)(shared_function_block*) noexcept;
+
+  shared_function_block(invoke_t i, destroy_t d)
+      : invoke(i)
+      , destroy(d)
+  {
+    refs.bind(&destroy_erased, this);
+  }
+
+  static void destroy_erased(void* block) noexcept
+  {
+    auto self = static_cast<shared_function_block*>(block);
+    self->destroy(self);
+  }
+
+  void add_ref() noexcept
+  {
+    refs.add_ref();
+  }
+
+  void release() noexcept
+  {
+    if (refs.release())
+      destroy(this);
+  }
+
+  invoke_t const invoke;
+  destroy_t const destroy;
+  RefCount refs;
+};
+
+template <typename Func, typename Alloc, typename RefCount, typename Ret,
+          typename... Args>
+struct shared_function_block_for
+    : shared_function_block<RefCount, Ret, Args...>
+    , Alloc
+{
+  using base = shared_function_block<RefCount, Ret, Args...>;
+
+  template <typename OFunc>
+  shared_function_block_for(Alloc const& alloc, OFunc&& f)
+      : base(&call, &destroy_block)
+      , Alloc(alloc)
+      , func(std::forward<OFunc>(f))
+  {
+  }
+
+  static Ret call(base* block, Args&&... args)
+  {
+    auto& f = static_cast<shared_function_block_for*>(block)->func;
+    if constexpr (std::is_void<Ret>::value)
+      f(std::forward<Args>(args)...);
+    else
+      return f(std::forward<Args>(args)...);
+  }
+
+  static void destroy_block(base* block) noexcept
+  {
+    auto self = static_cast<shared_function_block_for*>(block);
+    deallocate_object(Alloc(static_cast<Alloc const&>(*self)), self);
+  }
+
+  Func func;
+};
+
+} // namespace detail
+
+template <typename Signature, typename RefCount = atomic_ref_count>
 class shared_function;
 
-template <typename Ret, typename... Args>
-class shared_function<Ret(Args...)>
+template <typename Ret, typename... Args, typename RefCount>
+class shared_function<Ret(Args...), RefCount>
 {
 public:
   explicit operator bool() const;
 
   Ret operator()(Args... args) const;
 
-  std::function<Ret(Args...)> const& get() const;
-  std::function<Ret(Args...)>& get();
+  /// Returns std::function which shares the target with this object.
+  std::function<Ret(Args...)> to_function() const;
+
+  /**
+   * @deprecated The target is no longer kept in a std::function, so get()
+   * can't return a reference to it. It returns to_function() as a const
+   * value: reading callers keep working, callers which assigned the target
+   * through get() fail to compile instead of changing a temporary.
+   */
+  [[deprecated("use to_function()")]] std::function<Ret(Args...)> const
+  get() const;
 
   shared_function() = default;
   shared_function(std::nullptr_t);
   shared_function& operator=(std::nullptr_t);
 
-  shared_function(shared_function&& other) = default;
-  shared_function& operator=(shared_function&& other) = default;
+  shared_function(shared_function&& other) noexcept;
+  shared_function& operator=(shared_function&& other) noexcept;
+
+  shared_function(const shared_function& other) noexcept;
+  shared_function& operator=(const shared_function& other) noexcept;
 
-  shared_function(const shared_function& other) = default;
-  shared_function& operator=(const shared_function& other) = default;
+  ~shared_function();
 
   template <
       typename OFunc1,
@@ -53,6 +160,13 @@ public:
       typename = Requires<Not<std::is_convertible<OFunc1, shared_function>>>>
   shared_function(OFunc1&& call);
 
+  /// Allocates the shared block with \c alloc.
+  template <
+      typename Alloc, typename OFunc1,
+      typename = Requires<
+          Not<std::is_same<typename std::decay_t<OFunc1>, shared_function>>>>
+  shared_function(std::allocator_arg_t, Alloc const& alloc, OFunc1&& call);
+
   template <
       typename OFunc1,
       typename = Requires<
@@ -60,112 +174,233 @@ public:
       typename = Requires<Not<std::is_convertible<OFunc1, shared_function>>>>
   shared_function& operator=(OFunc1&& call);
 
-  void swap(shared_function& other);
+  void swap(shared_function& other) noexcept;
 
 private:
-  std::shared_ptr<std::function<Ret(Args...)>> mCall;
+  using block_t = detail::shared_function_block<RefCount, Ret, Args...>;
+
+  union target_t
+  {
+    block_t* block;
+    void (*function)();
+  };
+
+  using direct_t = Ret (*)(target_t, Args&&...);
+
+  template <typename Func>
+  struct direct_for;
+
+  // set for targets which need no block, mTarget.block is used otherwise
+  direct_t mDirect = nullptr;
+  target_t mTarget{nullptr};
 };
 
-template <typename Ret, typename... Args>
-shared_function<Ret(Args...)>::shared_function(std::nullptr_t)
+template <typename Ret, typename... Args, typename RefCount>
+template <typename Func>
+struct shared_function<Ret(Args...), RefCount>::direct_for
+{
+  static Ret call(target_t target, Args&&... args)
+  {
+    auto const function = reinterpret_cast<Func>(target.function);
+    if constexpr (std::is_void<Ret>::value)
+      function(std::forward<Args>(args)...);
+    else
+      return function(std::forward<Args>(args)...);
+  }
+};
+
+template <typename Ret, typename... Args, typename RefCount>
+shared_function<Ret(Args...), RefCount>::shared_function(std::nullptr_t)
     : shared_function()
 {
 }
 
-template <typename Ret, typename... Args>
-auto shared_function<Ret(Args...)>::operator=(std::nullptr_t)
+template <typename Ret, typename... Args, typename RefCount>
+auto shared_function<Ret(Args...), RefCount>::operator=(std::nullptr_t)
     -> shared_function&
 {
-  mCall = nullptr;
+  shared_function().swap(*this);
   return *this;
 }
 
-template <typename Ret, typename... Args>
+template <typename Ret, typename... Args, typename RefCount>
+shared_function<Ret(Args...), RefCount>::shared_function(
+    shared_function&& other) noexcept
+    : mDirect(other.mDirect)
+    , mTarget(other.mTarget)
+{
+  other.mDirect = nullptr;
+  other.mTarget.block = nullptr;
+}
+
+template <typename Ret, typename... Args, typename RefCount>
+auto shared_function<Ret(Args...), RefCount>::operator=(
+    shared_function&& other) noexcept -> shared_function&
+{
+  shared_function(std::move(other)).swap(*this);
+  return *this;
+}
+
+template <typename Ret, typename... Args, typename RefCount>
+shared_function<Ret(Args...), RefCount>::shared_function(
+    const shared_function& other) noexcept
+    : mDirect(other.mDirect)
+    , mTarget(other.mTarget)
+{
+  if (!mDirect && mTarget.block)
+    mTarget.block->add_ref();
+}
+
+template <typename Ret, typename... Args, typename RefCount>
+auto shared_function<Ret(Args...), RefCount>::operator=(
+    const shared_function& other) noexcept -> shared_function&
+{
+  shared_function(other).swap(*this);
+  return *this;
+}
+
+template <typename Ret, typename... Args, typename RefCount>
+shared_function<Ret(Args...), RefCount>::~shared_function()
+{
+  if (!mDirect && mTarget.block)
+    mTarget.block->release();
+}
+
+template <typename Ret, typename... Args, typename RefCount>
 template <typename OFunc1, typename, typename>
-shared_function<Ret(Args...)>::shared_function(OFunc1&& call)
-    : mCall(std::make_shared<std::function<Ret(Args...)>>(
-          std::forward<OFunc1>(call)))
+shared_function<Ret(Args...), RefCount>::shared_function(OFunc1&& call)
+    : shared_function(std::allocator_arg, std::allocator<char>(),
+                      std::forward<OFunc1>(call))
+{
+}
+
+template <typename Ret, typename... Args, typename RefCount>
+template <typename Alloc, typename OFunc1, typename>
+shared_function<Ret(Args...), RefCount>::shared_function(std::allocator_arg_t,
+                                                         Alloc const& alloc,
+                                                         OFunc1&& call)
 {
+  using func_t = std::decay_t<OFunc1>;
+
+  if constexpr (is_function_pointer<func_t>::value)
+    {
+      func_t const function = call;
+      if (!function)
+        return;
+
+      mDirect = &direct_for<func_t>::call;
+      mTarget.function = reinterpret_cast<void (*)()>(function);
+    }
+  else if constexpr (is_stateless_callable<func_t>::value)
+    {
+      // a captureless lambda is kept as the function pointer it converts to
+      auto const function = +call;
+      mDirect = &direct_for<std::decay_t<decltype(function)>>::call;
+      mTarget.function = reinterpret_cast<void (*)()>(function);
+    }
+  else
+    mTarget.block = detail::allocate_object<detail::shared_function_block_for<
+        func_t, Alloc, RefCount, Ret, Args...>>(alloc, alloc,
+                                                std::forward<OFunc1>(call));
 }
 
-template <typename Ret, typename... Args>
+template <typename Ret, typename... Args, typename RefCount>
 template <typename OFunc1, typename, typename>
-shared_function<Ret(Args...)>&
-shared_function<Ret(Args...)>::operator=(OFunc1&& call)
+shared_function<Ret(Args...), RefCount>&
+shared_function<Ret(Args...), RefCount>::operator=(OFunc1&& call)
 {
-  mCall =
-      std::make_shared<std::function<Ret(Args...)>>(std::forward<OFunc1>(call));
+  shared_function(std::forward<OFunc1>(call)).swap(*this);
   return *this;
 }
 
-template <typename Ret, typename... Args>
-shared_function<Ret(Args...)>::operator bool() const
+template <typename Ret, typename... Args, typename RefCount>
+shared_function<Ret(Args...), RefCount>::operator bool() const
 {
-  return mCall && mCall.get();
+  return mDirect || mTarget.block;
 }
 
-template <typename Ret, typename... Args>
-Ret shared_function<Ret(Args...)>::operator()(Args... args) const
+template <typename Ret, typename... Args, typename RefCount>
+Ret shared_function<Ret(Args...), RefCount>::operator()(Args... args) const
 {
-  if (!mCall)
+  if (mDirect)
+    return mDirect(mTarget, std::forward<Args>(args)...);
+
+  if (!mTarget.block)
     throw std::bad_function_call();
 
-  return mCall->operator()(std::forward<Args>(args)...);
+  return mTarget.block->invoke(mTarget.block, std::forward<Args>(args)...);
 }
 
-template <typename Ret, typename... Args>
-void shared_function<Ret(Args...)>::swap(shared_function& other)
+template <typename Ret, typename... Args, typename RefCount>
+void shared_function<Ret(Args...), RefCount>::swap(
+    shared_function& other) noexcept
 {
-  std::swap(mCall, other.mCall);
+  std::swap(mDirect, other.mDirect);
+  std::swap(mTarget, other.mTarget);
 }
 
-template <typename Ret, typename... Args>
-const std::function<Ret(Args...)>& shared_function<Ret(Args...)>::get() const
+template <typename Ret, typename... Args, typename RefCount>
+std::function<Ret(Args...)>
+shared_function<Ret(Args...), RefCount>::to_function() const
 {
-  return *mCall;
+  if (!*this)
+    return nullptr;
+
+  return *this;
 }
 
-template <typename Ret, typename... Args>
-std::function<Ret(Args...)>& shared_function<Ret(Args...)>::get()
+template <typename Ret, typename... Args, typename RefCount>
+std::function<Ret(Args...)> const
+shared_function<Ret(Args...), RefCount>::get() const
 {
-  return *mCall;
+  return to_function();
 }
 
-template <typename Ret, typename... Args>
-inline bool operator==(const shared_function<Ret(Args...)>& func,
+template <typename Ret, typename... Args, typename RefCount>
+inline bool operator==(const shared_function<Ret(Args...), RefCount>& func,
                        std::nullptr_t) noexcept
 {
   return !static_cast<bool>(func);
 }
 
-template <typename Ret, typename... Args>
-inline bool operator==(std::nullptr_t,
-                       const shared_function<Ret(Args...)>& func) noexcept
+template <typename Ret, typename... Args, typename RefCount>
+inline bool
+operator==(std::nullptr_t,
+           const shared_function<Ret(Args...), RefCount>& func) noexcept
 {
   return !static_cast<bool>(func);
 }
 
-template <typename Ret, typename... Args>
-inline bool operator!=(const shared_function<Ret(Args...)>& func,
+template <typename Ret, typename... Args, typename RefCount>
+inline bool operator!=(const shared_function<Ret(Args...), RefCount>& func,
                        std::nullptr_t) noexcept
 {
   return static_cast<bool>(func);
 }
 
-template <typename Ret, typename... Args>
-inline bool operator!=(std::nullptr_t,
-                       const shared_function<Ret(Args...)>& func) noexcept
+template <typename Ret, typename... Args, typename RefCount>
+inline bool
+operator!=(std::nullptr_t,
+           const shared_function<Ret(Args...), RefCount>& func) noexcept
 {
   return static_cast<bool>(func);
 }
 
+/// shared_function for single-threaded code, copies are not atomic.
+template <typename Signature>
+using local_shared_function = shared_function<Signature, local_ref_count>;
+
+/// shared_function whose copies by the creating thread are not atomic.
+template <typename Signature>
+using biased_shared_function = shared_function<Signature, biased_ref_count>;
+
 namespace swap_ns
 {
 
 using std::swap;
-template <typename Ret, typename... Args>
-inline void swap(shared_function<Ret(Args...)>& l,
-                 shared_function<Ret(Args...)>& r)
+template <typename Ret, typename... Args, typename RefCount>
+inline void swap(shared_function<Ret(Args...), RefCount>& l,
+                 shared_function<Ret(Args...), RefCount>& r)
 {
   l.swap(r);
 }
@@ -0,0 +1,320 @@
+// Copyright (C) 2021 Artem Komyshan
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "ak/callback_guardian.hpp"
+#include "ak/detail/guard_slot.hpp"
+#include "ak/not_empty_function.hpp"
+
+/**
+ * @brief The signal class calls every connected handler on emit, in the order
+ * of connection.
+ *
+ * Handlers are not_empty_function objects kept side by side in one vector, so
+ * a handler which fits into \c Capacity bytes costs no allocation and emit
+ * walks contiguous memory. connect() returns a handle which disconnects the
+ * handler in O(1).
+ *
+ * A handler disconnected outside of emit is destroyed right away, together
+ * with everything it captured. Handlers may connect and disconnect others, or
+ * themselves, while the signal is emitted: disconnected handlers are not
+ * called anymore and are destroyed when the outermost emit returns, handlers
+ * connected during emit are called from the next one.
+ *
+ * A handler connected with a callback_guardian is dropped the first time the
+ * signal sees its owner gone, the handler does not need to be guarded itself.
+ *
+ * ak::signal<void(Event const&)> changed;
+ * auto c = changed.connect(guardian, [this](Event const& e) { on_change(e); });
+ * changed(event);
+ * changed.disconnect(c);
+ *
+ * @note signal is not thread-safe.
+ */
+
+namespace ak
+{
+
+template <typename Signature,
+          std::size_t Capacity = default_function_capacity,
+          std::size_t Align = default_function_alignment>
+class signal;
+
+template <typename... Args, std::size_t Capacity, std::size_t Align>
+class signal<void(Args...), Capacity, Align>
+{
+  using handler_t = not_empty_function<void(Args...), Capacity, Align>;
+
+  struct entry
+  {
+    handler_t handler;
+    detail::guard_token guard;
+    std::uint32_t id;
+    bool connected;
+  };
+
+  // maps the id of a connection to the current position of its entry
+  struct id_entry
+  {
+    std::uint32_t index;
+    std::uint32_t generation;
+  };
+
+  static constexpr detail::guard_token unguarded{nullptr, 0};
+
+  static constexpr auto invalid_index =
+      std::numeric_limits<std::uint32_t>::max();
+
+public:
+  /// Identifies one connected handler, stays valid when others come and go.
+  struct connection
+  {
+    std::uint32_t id = std::numeric_limits<std::uint32_t>::max();
+    std::uint32_t generation = 0;
+  };
+
+  signal() = default;
+
+  /// @note A signal must not be moved while it is emitted.
+  signal(signal&&) = default;
+  signal& operator=(signal&&) = default;
+
+  signal(signal const&) = delete;
+  signal& operator=(signal const&) = delete;
+
+  template <typename Func>
+  connection connect(Func&& handler);
+
+  /// The handler is dropped once \c owner is destroyed or invalidated.
+  template <typename Func>
+  connection connect(callback_guardian const& owner, Func&& handler);
+
+  /// Returns false if the handler is already disconnected.
+  bool disconnect(connection c);
+
+  void disconnect_all();
+
+  bool connected(connection c) const noexcept;
+
+  /// Number of connected handlers.
+  std::size_t size() const noexcept
+  {
+    return mSize;
+  }
+
+  bool empty() const noexcept
+  {
+    return mSize == 0;
+  }
+
+  /// Makes room for \c handlers connections, connecting up to that many
+  /// inline handlers outside of emit allocates nothing.
+  void reserve(std::size_t handlers);
+
+  void operator()(Args... args);
+
+private:
+  template <typename Func>
+  connection add(detail::guard_token guard, Func&& handler);
+
+  entry& entry_at(std::uint32_t index) noexcept;
+
+  void drop(entry& e);
+
+  void compact();
+
+  std::vector<entry> mEntries;
+  // connected while emitting, mEntries can't grow under running handlers
+  std::vector<entry> mPending;
+  std::vector<id_entry> mIds;
+  std::vector<std::uint32_t> mFreeIds;
+  std::size_t mSize = 0;
+  std::size_t mDropped = 0;
+  unsigned mEmitting = 0;
+};
+
+template <typename... Args, std::size_t Capacity, std::size_t Align>
+template <typename Func>
+auto signal<void(Args...), Capacity, Align>::connect(Func&& handler)
+    -> connection
+{
+  return add(unguarded, std::forward<Func>(handler));
+}
+
+template <typename... Args, std::size_t Capacity, std::size_t Align>
+template <typename Func>
+auto signal<void(Args...), Capacity, Align>::connect(
+    callback_guardian const& owner, Func&& handler) -> connection
+{
+  return add(owner.token, std::forward<Func>(handler));
+}
+
+template <typename... Args, std::size_t Capacity, std::size_t Align>
+template <typename Func>
+auto signal<void(Args...), Capacity, Align>::add(detail::guard_token guard,
+                                                 Func&& handler) -> connection
+{
+  auto& entries = mEmitting ? mPending : mEntries;
+  auto const index =
+      static_cast<std::uint32_t>(mEntries.size() + mPending.size());
+
+  auto const reuse = !mFreeIds.empty();
+  auto const id =
+      reuse ? mFreeIds.back() : static_cast<std::uint32_t>(mIds.size());
+  if (!reuse)
+    mIds.push_back({invalid_index, 0});
+
+  entries.push_back({handler_t(std::forward<Func>(handler)), guard, id, true});
+  if (reuse)
+    mFreeIds.pop_back();
+  mIds[id].index = index;
+  ++mSize;
+  return {id, mIds[id].generation};
+}
+
+template <typename... Args, std::size_t Capacity, std::size_t Align>
+bool signal<void(Args...), Capacity, Align>::disconnect(connection c)
+{
+  if (!connected(c))
+    return false;
+
+  drop(entry_at(mIds[c.id].index));
+  if (!mEmitting && mDropped > mEntries.size() / 2)
+    compact();
+  return true;
+}
+
+template <typename... Args, std::size_t Capacity, std::size_t Align>
+void signal<void(Args...), Capacity, Align>::reserve(std::size_t handlers)
+{
+  mEntries.reserve(handlers);
+  mIds.reserve(handlers);
+  mFreeIds.reserve(handlers);
+}
+
+template <typename... Args, std::size_t Capacity, std::size_t Align>
+void signal<void(Args...), Capacity, Align>::disconnect_all()
+{
+  for (auto& e : mEntries)
+    if (e.connected)
+      drop(e);
+  for (auto& e : mPending)
+    if (e.connected)
+      drop(e);
+
+  if (!mEmitting)
+    compact();
+}
+
+template <typename... Args, std::size_t Capacity, std::size_t Align>
+bool signal<void(Args...), Capacity, Align>::connected(connection c) const
+    noexcept
+{
+  return c.id < mIds.size() && mIds[c.id].generation == c.generation &&
+         mIds[c.id].index != invalid_index;
+}
+
+template <typename... Args, std::size_t Capacity, std::size_t Align>
+void signal<void(Args...), Capacity, Align>::operator()(Args... args)
+{
+  struct emit_scope
+  {
+    explicit emit_scope(signal& s) noexcept : self(s)
+    {
+      ++self.mEmitting;
+    }
+
+    ~emit_scope()
+    {
+      if (--self.mEmitting == 0)
+        self.compact();
+    }
+
+    signal& self;
+  } scope(*this);
+
+  // handlers connected from now on are in mPending
+  auto const count = mEntries.size();
+  for (std::size_t i = 0; i < count; ++i)
+    {
+      auto& e = mEntries[i];
+      if (!e.connected)
+        continue;
+
+      if (e.guard.slot && !e.guard.alive())
+        {
+          drop(e);
+          continue;
+        }
+
+      e.handler(args...);
+    }
+}
+
+template <typename... Args, std::size_t Capacity, std::size_t Align>
+auto signal<void(Args...), Capacity, Align>::entry_at(
+    std::uint32_t index) noexcept -> entry&
+{
+  return index < mEntries.size() ? mEntries[index]
+                                 : mPending[index - mEntries.size()];
+}
+
+template <typename... Args, std::size_t Capacity, std::size_t Align>
+void signal<void(Args...), Capacity, Align>::drop(entry& e)
+{
+  e.connected = false;
+  auto& id = mIds[e.id];
+  id.index = invalid_index;
+  ++id.generation;
+  mFreeIds.push_back(e.id);
+  --mSize;
+  ++mDropped;
+
+  // while emitting the handler may be running, it is destroyed by compact();
+  // otherwise only the slot waits for compaction, an empty handler takes the
+  // place of the target
+  if (!mEmitting)
+    e.handler = [](Args...) {};
+}
+
+template <typename... Args, std::size_t Capacity, std::size_t Align>
+void signal<void(Args...), Capacity, Align>::compact()
+{
+  // the pending entries keep their indices when they are appended
+  for (auto& e : mPending)
+    mEntries.push_back(std::move(e));
+  mPending.clear();
+
+  if (mDropped == 0)
+    return;
+
+  std::size_t kept = 0;
+  for (std::size_t i = 0; i < mEntries.size(); ++i)
+    {
+      if (!mEntries[i].connected)
+        continue;
+
+      if (kept != i)
+        {
+          mEntries[kept] = std::move(mEntries[i]);
+          mIds[mEntries[kept].id].index = static_cast<std::uint32_t>(kept);
+        }
+      ++kept;
+    }
+
+  mEntries.erase(mEntries.begin() + kept, mEntries.end());
+  mDropped = 0;
+}
+
+} // namespace ak
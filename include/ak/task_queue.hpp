@@ -0,0 +1,183 @@
+// Copyright (C) 2021 Artem Komyshan
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <limits>
+#include <utility>
+
+#include "ak/call_once_silent.hpp"
+
+/**
+ * @brief task_queue is an unbounded lock-free queue of call-once tasks with
+ * many producers and a single consumer, e.g. I/O threads posting completions
+ * to an event loop.
+ *
+ * A task is a call_once_silent<> which lives in the node of the queue, so a
+ * small task costs exactly one allocation. Pushing is a single atomic
+ * exchange, the consumer takes tasks without any atomic read-modify-write.
+ *
+ * // any thread
+ * queue.post([state = std::move(state)]() mutable { finish(state); });
+ * // event loop thread
+ * queue.drain();
+ *
+ * task_queue is an executor (see ak/executor.hpp), the posted functions run
+ * on the thread which drains the queue. Tasks left in the queue are
+ * destroyed without being called.
+ */
+
+namespace ak
+{
+
+class task_queue
+{
+  struct node
+  {
+    node() = default;
+
+    template <typename Func>
+    explicit node(Func&& func)
+        : task(std::forward<Func>(func))
+    {
+    }
+
+    std::atomic<node*> next{nullptr};
+    call_once_silent<> task;
+  };
+
+public:
+  task_queue() noexcept
+      : mHead(&mStub)
+      , mTail(&mStub)
+  {
+  }
+
+  task_queue(task_queue const&) = delete;
+  task_queue& operator=(task_queue const&) = delete;
+
+  ~task_queue();
+
+  /// May be called from any thread.
+  template <typename Func>
+  void post(Func&& func);
+
+  /// Takes the oldest ready task, returns false if there is none.
+  /// Must be called from the consumer thread only.
+  bool try_pop(call_once_silent<>& task);
+
+  /// Runs up to \c limit ready tasks in the order they were posted and returns
+  /// how many ran. Must be called from the consumer thread only.
+  std::size_t drain(
+      std::size_t limit = std::numeric_limits<std::size_t>::max());
+
+  /// True if no task is ready. Must be called from the consumer thread only.
+  bool empty() const noexcept;
+
+private:
+  void push(node* n) noexcept;
+
+  node* pop() noexcept;
+
+  // consumer side and producer side are kept on different cache lines
+  alignas(64) node* mHead;
+  node mStub;
+  alignas(64) std::atomic<node*> mTail;
+};
+
+inline task_queue::~task_queue()
+{
+  while (auto n = pop())
+    delete n;
+}
+
+template <typename Func>
+void task_queue::post(Func&& func)
+{
+  push(new node(std::forward<Func>(func)));
+}
+
+inline bool task_queue::try_pop(call_once_silent<>& task)
+{
+  auto n = pop();
+  if (!n)
+    return false;
+
+  task = std::move(n->task);
+  delete n;
+  return true;
+}
+
+inline std::size_t task_queue::drain(std::size_t limit)
+{
+  std::size_t count = 0;
+  for (; count < limit; ++count)
+    {
+      auto n = pop();
+      if (!n)
+        break;
+
+      // the node is freed first, the task may post to this queue again
+      auto task = std::move(n->task);
+      delete n;
+      task();
+    }
+  return count;
+}
+
+inline bool task_queue::empty() const noexcept
+{
+  auto head = mHead;
+  if (head == &mStub)
+    head = head->next.load(std::memory_order_acquire);
+  return head == nullptr;
+}
+
+inline void task_queue::push(node* n) noexcept
+{
+  n->next.store(nullptr, std::memory_order_relaxed);
+  auto prev = mTail.exchange(n, std::memory_order_acq_rel);
+  // until this store the consumer sees the queue cut at prev
+  prev->next.store(n, std::memory_order_release);
+}
+
+inline task_queue::node* task_queue::pop() noexcept
+{
+  auto head = mHead;
+  auto next = head->next.load(std::memory_order_acquire);
+  if (head == &mStub)
+    {
+      if (!next)
+        return nullptr;
+
+      mHead = next;
+      head = next;
+      next = next->next.load(std::memory_order_acquire);
+    }
+
+  if (next)
+    {
+      mHead = next;
+      return head;
+    }
+
+  // head is the last node or a producer is between its exchange and store
+  if (head != mTail.load(std::memory_order_acquire))
+    return nullptr;
+
+  // the stub is put back so the last node can be handed out
+  push(&mStub);
+  next = head->next.load(std::memory_order_acquire);
+  if (!next)
+    return nullptr;
+
+  mHead = next;
+  return head;
+}
+
+} // namespace ak
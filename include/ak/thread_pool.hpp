@@ -0,0 +1,235 @@
+// Copyright (C) 2021 Artem Komyshan
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "ak/call_once_silent.hpp"
+
+/**
+ * @brief thread_pool runs callbacks on a fixed set of worker threads. Every
+ * worker has its own queue and runs it oldest first, an idle worker steals
+ * the newest task of a busy one, so a burst of tasks deferred by one worker
+ * spreads over the pool.
+ *
+ * Tasks are stored as call_once_silent<>: a posted call_once_silent<> is
+ * moved in as it is, any other callable, shared_function included, is
+ * wrapped into one and kept inline in the queue when it is small enough.
+ *
+ * - post() queues the task on the next worker in round-robin order, shared
+ *   by all the posting threads;
+ * - dispatch() runs the task right away when called on a worker of this pool,
+ *   otherwise it posts;
+ * - defer() queues the task on the calling worker, it runs there after the
+ *   current task unless another worker steals it first.
+ *
+ * thread_pool is an executor (see ak/executor.hpp). The destructor runs the
+ * tasks posted so far and joins the workers.
+ */
+
+namespace ak
+{
+
+class thread_pool
+{
+  struct worker
+  {
+    std::mutex mutex;
+    std::deque<call_once_silent<>> tasks;
+    std::thread thread;
+  };
+
+  struct current_worker
+  {
+    thread_pool* pool;
+    std::size_t index;
+  };
+
+public:
+  explicit thread_pool(
+      std::size_t threads = std::max(1u, std::thread::hardware_concurrency()));
+
+  thread_pool(thread_pool const&) = delete;
+  thread_pool& operator=(thread_pool const&) = delete;
+
+  ~thread_pool();
+
+  template <typename Func>
+  void post(Func&& func);
+
+  template <typename Func>
+  void dispatch(Func&& func);
+
+  template <typename Func>
+  void defer(Func&& func);
+
+  std::size_t size() const noexcept
+  {
+    return mWorkers.size();
+  }
+
+  /// True if the calling thread is a worker of this pool.
+  bool running_in_this_thread() const noexcept
+  {
+    return current().pool == this;
+  }
+
+private:
+  static current_worker& current() noexcept
+  {
+    thread_local current_worker self{nullptr, 0};
+    return self;
+  }
+
+  void push(std::size_t index, call_once_silent<> task);
+
+  bool pop(std::size_t index, call_once_silent<>& task);
+
+  bool steal(std::size_t thief, call_once_silent<>& task);
+
+  void run(std::size_t index);
+
+  std::vector<std::unique_ptr<worker>> mWorkers;
+  std::atomic<std::size_t> mNext{0};
+  std::atomic<std::size_t> mPending{0};
+  std::atomic<std::size_t> mSleeping{0};
+  std::mutex mSleepMutex;
+  std::condition_variable mWakeUp;
+  bool mStopping = false;
+};
+
+inline thread_pool::thread_pool(std::size_t threads)
+{
+  threads = std::max<std::size_t>(1, threads);
+  mWorkers.reserve(threads);
+  for (auto i = threads; i > 0; --i)
+    mWorkers.push_back(std::make_unique<worker>());
+
+  for (std::size_t i = 0; i < threads; ++i)
+    mWorkers[i]->thread = std::thread([this, i] { run(i); });
+}
+
+inline thread_pool::~thread_pool()
+{
+  {
+    std::lock_guard<std::mutex> lock(mSleepMutex);
+    mStopping = true;
+  }
+  mWakeUp.notify_all();
+
+  for (auto& w : mWorkers)
+    w->thread.join();
+}
+
+template <typename Func>
+void thread_pool::post(Func&& func)
+{
+  auto const index =
+      mNext.fetch_add(1, std::memory_order_relaxed) % mWorkers.size();
+  push(index, call_once_silent<>(std::forward<Func>(func)));
+}
+
+template <typename Func>
+void thread_pool::dispatch(Func&& func)
+{
+  if (running_in_this_thread())
+    std::forward<Func>(func)();
+  else
+    post(std::forward<Func>(func));
+}
+
+template <typename Func>
+void thread_pool::defer(Func&& func)
+{
+  if (running_in_this_thread())
+    push(current().index, call_once_silent<>(std::forward<Func>(func)));
+  else
+    post(std::forward<Func>(func));
+}
+
+inline void thread_pool::push(std::size_t index, call_once_silent<> task)
+{
+  {
+    auto& w = *mWorkers[index];
+    std::lock_guard<std::mutex> lock(w.mutex);
+    w.tasks.push_back(std::move(task));
+  }
+
+  // pairs with the check of mPending by a worker going to sleep
+  mPending.fetch_add(1, std::memory_order_seq_cst);
+  if (mSleeping.load(std::memory_order_seq_cst) > 0)
+    {
+      std::lock_guard<std::mutex> lock(mSleepMutex);
+      mWakeUp.notify_one();
+    }
+}
+
+inline bool thread_pool::pop(std::size_t index, call_once_silent<>& task)
+{
+  auto& w = *mWorkers[index];
+  std::lock_guard<std::mutex> lock(w.mutex);
+  if (w.tasks.empty())
+    return false;
+
+  task = std::move(w.tasks.front());
+  w.tasks.pop_front();
+  return true;
+}
+
+inline bool thread_pool::steal(std::size_t thief, call_once_silent<>& task)
+{
+  for (std::size_t i = 1; i < mWorkers.size(); ++i)
+    {
+      auto& w = *mWorkers[(thief + i) % mWorkers.size()];
+      std::unique_lock<std::mutex> lock(w.mutex, std::try_to_lock);
+      if (!lock || w.tasks.empty())
+        continue;
+
+      // the owner runs its tasks oldest first, the thief takes the newest
+      task = std::move(w.tasks.back());
+      w.tasks.pop_back();
+      return true;
+    }
+  return false;
+}
+
+inline void thread_pool::run(std::size_t index)
+{
+  current() = {this, index};
+
+  for (;;)
+    {
+      call_once_silent<> task;
+      if (pop(index, task) || steal(index, task))
+        {
+          mPending.fetch_sub(1, std::memory_order_relaxed);
+          task();
+          continue;
+        }
+
+      std::unique_lock<std::mutex> lock(mSleepMutex);
+      mSleeping.fetch_add(1, std::memory_order_seq_cst);
+      mWakeUp.wait(lock, [this] {
+        return mPending.load(std::memory_order_seq_cst) > 0 || mStopping;
+      });
+      mSleeping.fetch_sub(1, std::memory_order_relaxed);
+
+      if (mStopping && mPending.load(std::memory_order_acquire) == 0)
+        return;
+    }
+}
+
+} // namespace ak
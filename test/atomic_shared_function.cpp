@@ -0,0 +1,138 @@
+// Copyright (C) 2021 Artem Komyshan
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "ak/atomic_shared_function.hpp"
+
+#include "test.hpp"
+
+TEST(atomic_shared_function_store)
+{
+  ak::atomic_shared_function<int(int)> func;
+  assert(!func);
+  auto thrown = false;
+  try
+    {
+      func(1);
+    }
+  catch (std::bad_function_call const&)
+    {
+      thrown = true;
+    }
+  assert(thrown);
+
+  auto token = std::make_shared<int>(1);
+  func = [token](int a) { return a + *token; };
+  assert(func);
+  assert(func(1) == 2);
+  assert(token.use_count() == 2);
+
+  auto copy = func.load();
+  func.store([](int a) { return a * 10; });
+  assert(func(2) == 20);
+  assert(copy(2) == 3);
+
+  // the replaced target is gone once the last copy is
+  copy = nullptr;
+  assert(token.use_count() == 1);
+
+  func.store(nullptr);
+  assert(!func);
+  assert(!func.load());
+};
+
+TEST(atomic_shared_function_reader_keeps_target)
+{
+  auto token = std::make_shared<int>(5);
+  ak::atomic_shared_function<int()> func;
+  std::atomic<bool> entered{false};
+  std::atomic<bool> stored{false};
+  std::atomic<int> result{0};
+
+  func = [token, &entered, &stored] {
+    entered = true;
+    while (!stored)
+      std::this_thread::yield();
+    return *token;
+  };
+
+  std::thread reader([&func, &result] { result = func(); });
+  while (!entered)
+    std::this_thread::yield();
+
+  func.store([] { return 0; });
+  // the reader still runs the old target
+  assert(token.use_count() == 2);
+  stored = true;
+  reader.join();
+  assert(result == 5);
+
+  func.collect();
+  assert(token.use_count() == 1);
+};
+
+TEST(atomic_shared_function_store_from_target)
+{
+  ak::atomic_shared_function<int()> func;
+  auto token = std::make_shared<int>(1);
+  func = [&func, token] {
+    func.store([] { return 2; });
+    return *token;
+  };
+
+  assert(func() == 1);
+  assert(func() == 2);
+  func.collect();
+  assert(token.use_count() == 1);
+};
+
+TEST(atomic_shared_function_deep_recursion)
+{
+  ak::atomic_shared_function<int(int)> func;
+  auto token = std::make_shared<int>(1);
+  func = [&func, token](int n) { return n == 0 ? 0 : *token + func(n - 1); };
+
+  // nests deeper than one chunk of hazard pointers
+  constexpr int depth = 3 * ak::detail::hazard_slots::count;
+  assert(func(depth) == depth);
+
+  func = nullptr;
+  func.collect();
+  assert(token.use_count() == 1);
+};
+
+TEST(atomic_shared_function_concurrent)
+{
+  ak::atomic_shared_function<int(int)> func = [](int a) { return a; };
+  std::atomic<bool> stop{false};
+  std::atomic<long> sum{0};
+
+  std::vector<std::thread> readers;
+  for (auto i = 0; i < 3; ++i)
+    readers.emplace_back([&] {
+      long local = 0;
+      while (!stop)
+        local += func(1);
+      sum += local;
+    });
+
+  for (auto i = 0; i < 1000; ++i)
+    {
+      auto token = std::make_shared<int>(0);
+      func.store([token](int a) { return a + *token; });
+    }
+  stop = true;
+  for (auto& r : readers)
+    r.join();
+
+  assert(func(1) == 1);
+  assert(sum >= 0);
+};
@@ -0,0 +1,176 @@
+// Copyright (C) 2021 Artem Komyshan
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include "ak/awaitable.hpp"
+
+#if defined(__cpp_impl_coroutine)
+
+#include <coroutine>
+#include <exception>
+#include <future>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "ak/call_once_silent.hpp"
+
+#include "test.hpp"
+
+using namespace ak;
+
+namespace awaitable_test
+{
+
+/// Starts right away, nothing waits for it to finish. The coroutines below
+/// take their state as parameters, the captures of a lambda are gone once
+/// the statement which made it ends.
+struct detached
+{
+  struct promise_type
+  {
+    detached get_return_object() noexcept
+    {
+      return {};
+    }
+
+    std::suspend_never initial_suspend() noexcept
+    {
+      return {};
+    }
+
+    std::suspend_never final_suspend() noexcept
+    {
+      return {};
+    }
+
+    void return_void() noexcept {}
+
+    void unhandled_exception() noexcept
+    {
+      std::terminate();
+    }
+  };
+};
+
+void async_add(int a, int b, call_once_silent<int> done)
+{
+  done(a + b);
+}
+
+struct deferred_api
+{
+  void operator()(std::string text, call_once_silent<std::string, int> done)
+  {
+    pending.push_back([text, done = std::move(done)]() mutable {
+      done(text, static_cast<int>(text.size()));
+    });
+  }
+
+  std::vector<call_once_silent<>> pending;
+};
+
+struct queue_executor
+{
+  void post(call_once_silent<> func)
+  {
+    tasks.push_back(std::move(func));
+  }
+
+  std::vector<call_once_silent<>> tasks;
+};
+
+} // namespace awaitable_test
+
+TEST(awaitable_completes_in_place)
+{
+  auto sum = 0;
+  [](int& sum) -> awaitable_test::detached {
+    sum = co_await as_awaitable<int>(&awaitable_test::async_add, 2, 3);
+  }(sum);
+  assert(sum == 5);
+};
+
+TEST(awaitable_completes_later)
+{
+  awaitable_test::deferred_api api;
+  api.pending.reserve(1);
+  std::tuple<std::string, int> result;
+
+  [](auto& api, auto& result) -> awaitable_test::detached {
+    result = co_await as_awaitable<std::string, int>(std::ref(api), "four");
+  }(api, result);
+  assert(api.pending.size() == 1);
+  assert(std::get<1>(result) == 0);
+
+  // the results are stored in the coroutine frame
+  allocation_counter counter;
+  api.pending.front()();
+  ASSERT_ALLOCATIONS(counter, 0);
+  assert(std::get<0>(result) == "four" && std::get<1>(result) == 4);
+};
+
+TEST(awaitable_no_results)
+{
+  call_once_silent<> pending;
+  auto resumed = false;
+
+  [](auto& pending, bool& resumed) -> awaitable_test::detached {
+    co_await as_awaitable<>(
+        [&pending](call_once_silent<> done) { pending = std::move(done); });
+    resumed = true;
+  }(pending, resumed);
+  assert(!resumed);
+
+  pending();
+  assert(resumed);
+};
+
+TEST(awaitable_broken)
+{
+  call_once_silent<int> pending;
+  auto broken = false;
+
+  [](auto& pending, bool& broken) -> awaitable_test::detached {
+    try
+      {
+        co_await as_awaitable<int>(
+            [&pending](call_once_silent<int> done) {
+              pending = std::move(done);
+            });
+      }
+    catch (std::future_error const& e)
+      {
+        broken = e.code() == std::future_errc::broken_promise;
+      }
+  }(pending, broken);
+  assert(!broken);
+
+  pending = nullptr;
+  assert(broken);
+};
+
+TEST(awaitable_executor)
+{
+  awaitable_test::queue_executor executor;
+  call_once_silent<int> pending;
+  auto value = 0;
+
+  [](auto& executor, auto& pending, int& value) -> awaitable_test::detached {
+    value = co_await as_awaitable<int>(
+        executor, [&pending](call_once_silent<int> done) {
+          pending = std::move(done);
+        });
+  }(executor, pending, value);
+
+  pending(7);
+  assert(value == 0);
+  assert(executor.tasks.size() == 1);
+
+  executor.tasks.front()();
+  assert(value == 7);
+};
+
+#endif
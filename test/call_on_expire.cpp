@@ -4,7 +4,14 @@
 // License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
 // http://www.boost.org/LICENSE_1_0.txt)
 
+#include <atomic>
+#include <functional>
+#include <type_traits>
+#include <vector>
+
 #include "ak/call_on_expire.hpp"
+#include "ak/executor.hpp"
+#include "ak/thread_pool.hpp"
 
 #include "test.hpp"
 
@@ -48,4 +55,47 @@ TEST(call_on_expire_release)
   coe.release();
 
   assert(called);
-};
\ No newline at end of file
+};
+
+TEST(call_on_expire_executor)
+{
+  struct queue_executor
+  {
+    void post(call_once_silent<> func)
+    {
+      tasks.push_back(std::move(func));
+    }
+
+    std::vector<call_once_silent<>> tasks;
+  };
+
+  // only an executor selects the posting constructors
+  static_assert(!std::is_constructible<call_on_expire, int&, void (*)()>::value,
+                "");
+
+  auto called = 0;
+  queue_executor executor;
+  {
+    call_on_expire coe{executor, [&called] { ++called; }};
+    call_on_expire ocoe = coe;
+  }
+
+  assert(called == 0);
+  assert(executor.tasks.size() == 1);
+  executor.tasks.front()();
+  assert(called == 1);
+
+  inline_executor inline_exec;
+  {
+    call_on_expire coe{inline_exec, [&called] { ++called; }};
+  }
+  assert(called == 2);
+
+  std::atomic<int> pool_called{0};
+  {
+    thread_pool pool(2);
+    call_on_expire coe{pool, [&pool_called] { ++pool_called; }};
+    coe.release();
+  }
+  assert(pool_called == 1);
+};
@@ -4,6 +4,12 @@
 // License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
 // http://www.boost.org/LICENSE_1_0.txt)
 
+#include <array>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
 #include "ak/call_once_silent.hpp"
 
 #include "test.hpp"
@@ -76,3 +82,148 @@ TEST(call_once_silent_null_ptr)
   call_once_silent<int, int> vf3 = nullptr;
   assert(vf3 == nullptr);
 };
+
+TEST(call_once_silent_move_only_target)
+{
+  auto result = 0;
+  auto value = std::make_unique<int>(42);
+  call_once_silent<int> vf = [&result, v = std::move(value)](int a) {
+    result = *v + a;
+  };
+
+  call_once_silent<int> moved = std::move(vf);
+  assert(vf == nullptr);
+
+  moved(1);
+  assert(43 == result);
+  assert(moved == nullptr);
+};
+
+TEST(call_once_silent_target_released_after_call)
+{
+  auto counter = std::make_shared<int>(0);
+  std::array<char, 256> big{};
+
+  call_once_silent<> small = [counter] { ++*counter; };
+  call_once_silent<> large = [counter, big] { *counter += big[0] + 1; };
+  assert(counter.use_count() == 3);
+
+  small();
+  large();
+  assert(*counter == 2);
+  assert(counter.use_count() == 1);
+};
+
+TEST(call_once_silent_reassign_from_target)
+{
+  auto count = 0u;
+  call_once_silent<> vf;
+  vf = [&vf, &count] {
+    ++count;
+    vf = [&count] { count += 10; };
+  };
+
+  vf();
+  assert(1u == count);
+  assert(vf != nullptr);
+
+  vf();
+  assert(11u == count);
+  assert(vf == nullptr);
+};
+
+TEST(concurrent_call_once_silent_simple)
+{
+  auto count = 0u;
+  concurrent_call_once_silent<int> vf = [&count](int a) { count += a; };
+  assert(vf != nullptr);
+
+  concurrent_call_once_silent<int> moved = std::move(vf);
+  assert(vf == nullptr);
+  vf(1);
+  assert(0u == count);
+
+  moved(2);
+  moved(3);
+  assert(2u == count);
+  assert(moved == nullptr);
+
+  call_once_silent<int> once = [&count](int a) { count += a; };
+  concurrent_call_once_silent<int> from_once = std::move(once);
+  auto released = from_once.release();
+  assert(from_once == nullptr);
+  from_once(4);
+  released(5);
+  assert(7u == count);
+
+  concurrent_call_once_silent<int> empty;
+  assert(empty == nullptr);
+  empty = nullptr;
+  empty(1);
+};
+
+TEST(concurrent_call_once_silent_race)
+{
+  for (auto round = 0; round < 100; ++round)
+    {
+      std::atomic<int> calls{0};
+      std::atomic<bool> go{false};
+      auto payload = std::make_unique<int>(round);
+
+      concurrent_call_once_silent<int> vf =
+          [&calls, p = std::move(payload)](int) { ++calls; };
+
+      std::vector<std::thread> threads;
+      for (auto i = 0; i < 4; ++i)
+        threads.emplace_back([&vf, &go, i] {
+          while (!go)
+            std::this_thread::yield();
+          for (auto j = 0; j < 100; ++j)
+            vf(i);
+        });
+
+      go = true;
+      for (auto& thread : threads)
+        thread.join();
+
+      assert(calls == 1);
+      assert(vf == nullptr);
+    }
+};
+
+TEST(call_once_silent_allocations)
+{
+  auto count = 0;
+
+  allocation_counter counter;
+  call_once_silent<int> vf = [&count](int a) { count += a; };
+  concurrent_call_once_silent<int> concurrent = std::move(vf);
+  concurrent(1);
+  ASSERT_ALLOCATIONS(counter, 0);
+  assert(count == 1);
+};
+
+namespace call_once_silent_test
+{
+
+struct member_target
+{
+  void add(int a)
+  {
+    value += a;
+  }
+
+  int value = 0;
+};
+
+} // namespace call_once_silent_test
+
+TEST(call_once_silent_member_pointer)
+{
+  using call_once_silent_test::member_target;
+
+  member_target target;
+  call_once_silent<member_target&, int> add = &member_target::add;
+  add(target, 2);
+  assert(target.value == 2);
+};
@@ -0,0 +1,112 @@
+// Copyright (C) 2020 Artem Komyshan
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "ak/call_once_strict.hpp"
+
+#include "test.hpp"
+
+using namespace ak;
+
+TEST(call_once_strict_simple_call)
+{
+  auto count = 0u;
+  auto vf = makeTECallOnce([&count](int a) { return count += a; });
+  assert(vf != nullptr);
+
+  assert(2u == vf(2));
+  assert(vf == nullptr);
+
+  try
+    {
+      vf(2);
+      assert(!"Exception expected");
+    }
+  catch (std::bad_function_call const&)
+    {
+    }
+  catch (...)
+    {
+      assert(!"Unexpected exception");
+    }
+  assert(2u == count);
+};
+
+TEST(call_once_strict_empty)
+{
+  call_once_strict<std::function<void()>> vf1;
+  assert(vf1 == nullptr);
+
+  call_once_strict<std::function<void()>> vf2{std::function<void()>()};
+  assert(vf2 == nullptr);
+
+  call_once_strict<std::function<void()>, ignore_repeat> vf3 = nullptr;
+  assert(vf3 == nullptr);
+  vf3();
+};
+
+TEST(call_once_strict_copy_move)
+{
+  auto value = std::make_shared<int>(1);
+  auto vf = makeTECallOnce([value] { return *value; });
+
+  auto copy = vf;
+  assert(copy != nullptr);
+  assert(1 == copy());
+  assert(copy == nullptr);
+  assert(vf != nullptr);
+
+  auto moved = std::move(vf);
+  assert(vf == nullptr);
+  assert(moved != nullptr);
+
+  auto released = moved.release();
+  assert(released);
+  assert(!moved.release());
+  assert(1 == (*released)());
+
+  call_once_strict<std::function<int()>> vf2;
+  vf2 = [value] { return *value + 1; };
+  assert(2 == vf2());
+};
+
+TEST(call_once_strict_race)
+{
+  for (auto round = 0; round < 100; ++round)
+    {
+      std::atomic<int> calls{0};
+      std::atomic<int> rejected{0};
+      std::atomic<bool> go{false};
+
+      call_once_strict<std::function<void()>> vf{[&calls] { ++calls; }};
+
+      std::vector<std::thread> threads;
+      for (auto i = 0; i < 4; ++i)
+        threads.emplace_back([&] {
+          while (!go)
+            std::this_thread::yield();
+          try
+            {
+              vf();
+            }
+          catch (std::bad_function_call const&)
+            {
+              ++rejected;
+            }
+        });
+
+      go = true;
+      for (auto& thread : threads)
+        thread.join();
+
+      assert(calls == 1);
+      assert(rejected == 3);
+    }
+};
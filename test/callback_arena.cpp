@@ -0,0 +1,88 @@
+// Copyright (C) 2021 Artem Komyshan
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <array>
+#include <memory>
+#include <vector>
+
+#include "ak/call_once_silent.hpp"
+#include "ak/callback_arena.hpp"
+#include "ak/callback_guardian.hpp"
+#include "ak/not_empty_function.hpp"
+
+#include "test.hpp"
+
+TEST(callback_arena_create)
+{
+  std::array<char, 128> big{};
+  big[0] = 2;
+  auto called = 0;
+
+  alignas(std::max_align_t) unsigned char buffer[2048];
+  ak::callback_arena arena(buffer, sizeof(buffer),
+                           std::pmr::null_memory_resource());
+
+  ak::callback_guardian guardian;
+  allocation_counter counter;
+  auto& once = arena.create<ak::call_once_silent<>>(
+      std::allocator_arg, arena.get_allocator(),
+      [big, &called] { called += big[0]; });
+  auto& func = arena.create<ak::not_empty_function<int()>>(
+      std::allocator_arg, arena.get_allocator(), [big] { return int(big[0]); });
+  auto& guarded =
+      arena.store(guardian.make_guarded_callback([&called] { ++called; }));
+  ASSERT_ALLOCATIONS(counter, 0);
+
+  once();
+  guarded();
+  assert(called == 3);
+  assert(func() == 2);
+
+  arena.release();
+  ASSERT_ALLOCATIONS(counter, 0);
+};
+
+TEST(callback_arena_release_order)
+{
+  struct recorder
+  {
+    ~recorder()
+    {
+      order.push_back(id);
+    }
+
+    std::vector<int>& order;
+    int id;
+  };
+
+  std::vector<int> order;
+  {
+    ak::callback_arena arena;
+    arena.create<recorder>(recorder{order, 1});
+    arena.create<int>(42);
+    arena.create<recorder>(recorder{order, 2});
+    order.clear();
+  }
+  assert((order == std::vector<int>{2, 1}));
+};
+
+TEST(callback_arena_reuse)
+{
+  ak::callback_arena arena(64);
+  auto calls = 0;
+  for (auto round = 0; round < 3; ++round)
+    {
+      for (auto i = 0; i < 100; ++i)
+        {
+          auto& cb = arena.create<ak::call_once_silent<>>(
+              std::allocator_arg, arena.get_allocator(),
+              [&calls, pad = std::array<char, 64>{}] { ++calls; });
+          cb();
+        }
+      arena.release();
+    }
+  assert(calls == 300);
+};
@@ -0,0 +1,65 @@
+// Copyright (C) 2021 Artem Komyshan
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <memory>
+#include <vector>
+
+#include "ak/callback_collection.hpp"
+#include "ak/not_empty_function.hpp"
+
+#include "test.hpp"
+
+namespace
+{
+
+struct add_one
+{
+  void operator()(std::vector<int>& out) const
+  {
+    out.push_back(1);
+  }
+};
+
+} // namespace
+
+TEST(callback_collection_segments)
+{
+  ak::callback_collection<void(std::vector<int>&)> callbacks;
+  assert(callbacks.empty());
+
+  auto const add_two = [](std::vector<int>& out) { out.push_back(2); };
+  callbacks.insert(add_one{});
+  callbacks.insert(add_two);
+  callbacks.insert(add_one{});
+  callbacks.insert(add_two);
+  callbacks.insert(ak::not_empty_function<void(std::vector<int>&)>(
+      [](std::vector<int>& out) { out.push_back(3); }));
+
+  assert(callbacks.size() == 5);
+  assert(callbacks.segment_count() == 3);
+
+  std::vector<int> out;
+  callbacks(out);
+  assert((out == std::vector<int>{1, 1, 2, 2, 3}));
+};
+
+TEST(callback_collection_clear)
+{
+  auto token = std::make_shared<int>(0);
+  ak::callback_collection<void(int)> callbacks;
+  callbacks.insert([token](int v) { *token += v; });
+  callbacks.insert([token](int v) { *token += v * 10; });
+  callbacks(2);
+  assert(*token == 22);
+  assert(token.use_count() == 3);
+
+  callbacks.clear();
+  assert(callbacks.empty());
+  assert(token.use_count() == 1);
+  assert(callbacks.segment_count() == 2);
+  callbacks(2);
+  assert(*token == 22);
+};
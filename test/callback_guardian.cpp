@@ -4,6 +4,12 @@
 // License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
 // http://www.boost.org/LICENSE_1_0.txt)
 
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
 #include "ak/callback_guardian.hpp"
 
 #include "test.hpp"
@@ -84,4 +90,184 @@ TEST(callback_guardian_copy)
   call();
   assert(cout_cb == 0);
   assert(cout_error_cb == 1);
-};
\ No newline at end of file
+};
+
+class ConcurrentTest
+{
+public:
+  explicit ConcurrentTest(std::atomic<int>& calls)
+      : calls(calls)
+  {
+  }
+
+  ~ConcurrentTest()
+  {
+    guard.expire();
+    alive = false;
+  }
+
+  auto get_cb()
+  {
+    return guard.make_guarded_callback([this] {
+      assert(alive);
+      std::this_thread::yield();
+      assert(alive);
+      ++calls;
+    });
+  }
+
+  std::function<void()>
+  self_destroying_cb(std::unique_ptr<ConcurrentTest>& self)
+  {
+    return guard.make_guarded_callback([&self] { self.reset(); });
+  }
+
+private:
+  std::atomic<int>& calls;
+  bool alive = true;
+  concurrent_callback_guardian guard;
+};
+
+TEST(concurrent_callback_guardian_simple)
+{
+  std::atomic<int> calls{0};
+  int errors = 0;
+
+  std::function<void()> call;
+  std::function<void()> rejected;
+  {
+    ConcurrentTest guarded(calls);
+    call = guarded.get_cb();
+    call();
+    assert(calls == 1);
+
+    concurrent_callback_guardian guard;
+    rejected = guard.make_guarded_callback([] { assert(!"Unexpected call"); },
+                                           [&errors] { ++errors; });
+  }
+  call();
+  rejected();
+  assert(calls == 1);
+  assert(errors == 1);
+};
+
+TEST(concurrent_callback_guardian_destroy_from_callback)
+{
+  std::atomic<int> calls{0};
+  auto guarded = std::make_unique<ConcurrentTest>(calls);
+  auto call = guarded->self_destroying_cb(guarded);
+
+  call();
+  assert(!guarded);
+};
+
+TEST(concurrent_callback_guardian_slot_kept_until_call_returns)
+{
+  auto guard = std::make_unique<concurrent_callback_guardian>();
+  auto called = false;
+
+  // the next guardian must not get the slot while the call which destroyed
+  // the previous one is still counted in it, expiring it on another thread
+  // would wait for that call forever
+  guard->make_guarded_callback([&guard, &called] {
+    guard.reset();
+    concurrent_callback_guardian next;
+    auto call = next.make_guarded_callback([&called] { called = true; });
+    std::thread([&next] { next.expire(); }).join();
+    call();
+  })();
+  assert(!called);
+};
+
+TEST(concurrent_callback_guardian_race)
+{
+  for (auto round = 0; round < 20; ++round)
+    {
+      std::atomic<int> calls{0};
+      std::atomic<bool> started{false};
+      auto guarded = std::make_unique<ConcurrentTest>(calls);
+      auto call = guarded->get_cb();
+
+      std::vector<std::thread> threads;
+      for (auto i = 0; i < 4; ++i)
+        threads.emplace_back([call, &started] {
+          started = true;
+          for (auto j = 0; j < 1000; ++j)
+            call();
+        });
+
+      while (!started)
+        std::this_thread::yield();
+      guarded.reset();
+
+      for (auto& thread : threads)
+        thread.join();
+      assert(calls <= 4000);
+    }
+};
+
+TEST(callback_guardian_invalidate_all)
+{
+  int cout_cb = 0;
+  int cout_error_cb = 0;
+
+  callback_guardian guard;
+  auto call = guard.make_guarded_callback(
+      [&cout_cb] { ++cout_cb; }, [&cout_error_cb] { ++cout_error_cb; });
+  static_assert(std::is_trivially_copyable<decltype(call)>::value, "");
+
+  call();
+  guard.invalidate_all();
+  call();
+  assert(cout_cb == 1);
+  assert(cout_error_cb == 1);
+
+  auto fresh = guard.make_guarded_callback([&cout_cb] { ++cout_cb; });
+  fresh();
+  call();
+  assert(cout_cb == 2);
+  assert(cout_error_cb == 2);
+
+  concurrent_callback_guardian concurrent_guard;
+  auto concurrent_call =
+      concurrent_guard.make_guarded_callback([&cout_cb] { ++cout_cb; });
+  concurrent_guard.invalidate_all();
+  concurrent_call();
+  assert(cout_cb == 2);
+};
+
+TEST(callback_guardian_slot_reuse)
+{
+  int cout_cb = 0;
+
+  std::vector<std::function<void()>> calls;
+  for (auto i = 0; i < 200; ++i)
+    {
+      callback_guardian guard;
+      calls.push_back(guard.make_guarded_callback([&cout_cb] { ++cout_cb; }));
+    }
+
+  callback_guardian guard;
+  auto call = guard.make_guarded_callback([&cout_cb] { ++cout_cb; });
+  for (auto& expired : calls)
+    expired();
+  assert(cout_cb == 0);
+
+  call();
+  assert(cout_cb == 1);
+};
+
+TEST(callback_guardian_allocations)
+{
+  int cout_cb = 0;
+  callback_guardian guard;
+
+  allocation_counter counter;
+  auto call = guard.make_guarded_callback([&cout_cb] { ++cout_cb; });
+  auto copy = call;
+  copy();
+  guard.invalidate_all();
+  call();
+  ASSERT_ALLOCATIONS(counter, 0);
+  assert(cout_cb == 1);
+};
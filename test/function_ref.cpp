@@ -0,0 +1,123 @@
+// Copyright (C) 2020 Artem Komyshan
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <array>
+#include <type_traits>
+#include <vector>
+
+#include "ak/call_once_silent.hpp"
+#include "ak/function_ref.hpp"
+#include "ak/not_empty_function.hpp"
+#include "ak/shared_function.hpp"
+
+#include "test.hpp"
+
+using namespace ak;
+
+namespace
+{
+
+int square(int i)
+{
+  return i * i;
+}
+
+int sum_all(std::vector<int> const& items, function_ref<int(int)> map)
+{
+  auto sum = 0;
+  for (auto item : items)
+    sum += map(item);
+  return sum;
+}
+
+struct member_target
+{
+  int get() const
+  {
+    return value;
+  }
+
+  int value;
+};
+
+int read_member(member_target const& target,
+                function_ref<int(member_target const&)> getter)
+{
+  return getter(target);
+}
+
+} // namespace
+
+TEST(function_ref_simple)
+{
+  static_assert(std::is_trivially_copyable<function_ref<int(int)>>::value,
+                "");
+  static_assert(sizeof(function_ref<int(int)>) == 2 * sizeof(void*), "");
+
+  std::vector<int> items{1, 2, 3};
+
+  auto offset = 1;
+  assert(sum_all(items, [offset](int i) { return i + offset; }) == 9);
+  assert(sum_all(items, square) == 14);
+  assert(sum_all(items, &square) == 14);
+
+  function_ref<int(int)> f = square;
+  assert(f);
+  assert(f != nullptr);
+  assert(!(nullptr == f));
+};
+
+TEST(function_ref_refers_to_target)
+{
+  auto count = 0;
+  auto counter = [&count]() mutable { return ++count; };
+
+  function_ref<int()> f1 = counter;
+  function_ref<int()> f2 = f1;
+  assert(f1() == 1);
+  assert(f2() == 2);
+
+  auto other = [] { return 0; };
+  function_ref<int()> f3 = other;
+  f3.swap(f1);
+  assert(f1() == 0);
+  assert(f3() == 3);
+};
+
+TEST(function_ref_from_wrappers)
+{
+  std::vector<int> items{1, 2, 3};
+
+  not_empty_function<int(int)> nef = [](int i) { return i * 2; };
+  assert(sum_all(items, nef) == 12);
+
+  shared_function<int(int)> sf = [](int i) { return i * 3; };
+  assert(sum_all(items, sf) == 18);
+
+  auto count = 0;
+  call_once_silent<int> once = [&count](int i) { count += i; };
+  function_ref<void(int)> f = once;
+  f(5);
+  f(5);
+  assert(count == 5);
+};
+
+TEST(function_ref_allocations)
+{
+  std::vector<int> items{1, 2, 3};
+  std::array<char, 256> big{};
+
+  allocation_counter counter;
+  assert(sum_all(items, [big](int i) { return i + big[0]; }) == 6);
+  ASSERT_ALLOCATIONS(counter, 0);
+};
+
+TEST(function_ref_member_pointers)
+{
+  member_target const target{4};
+  assert(read_member(target, &member_target::get) == 4);
+  assert(read_member(target, &member_target::value) == 4);
+};
@@ -0,0 +1,142 @@
+// Copyright (C) 2021 Artem Komyshan
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ak/join_counter.hpp"
+
+#include "test.hpp"
+
+using namespace ak;
+
+TEST(join_counter_results)
+{
+  std::vector<std::string> collected;
+  auto calls = 0;
+
+  join_counter<std::string> join(3, [&](join_results<std::string> results) {
+    ++calls;
+    for (auto& result : results)
+      collected.push_back(result ? std::move(*result) : "none");
+  });
+  assert(join.size() == 3);
+
+  auto first = join.make_completion();
+  auto second = join.make_completion();
+  auto third = join.make_completion();
+  join.release();
+  assert(!join);
+
+  third("c");
+  first(std::string("a"));
+  assert(calls == 0);
+
+  // a dropped completion is done too
+  second = {};
+  assert(calls == 1);
+  assert((collected == std::vector<std::string>{"a", "none", "c"}));
+
+  // the completion is spent after the first call
+  assert(!first);
+  first("again");
+  assert(calls == 1);
+};
+
+TEST(join_counter_release)
+{
+  auto calls = 0;
+
+  {
+    join_counter<int> join(4, [&calls](join_results<int> results) {
+      ++calls;
+      assert(results.size() == 4);
+      assert(results[0] == 1 && !results[1]);
+    });
+    join.make_completion()(1);
+    assert(calls == 0);
+  }
+
+  // the completions not made are given up by the destructor
+  assert(calls == 1);
+};
+
+TEST(join_counter_void)
+{
+  auto calls = 0;
+  join_counter<> join(2, [&calls] { ++calls; });
+
+  std::vector<join_counter<>::completion> completions;
+  completions.push_back(join.make_completion());
+  completions.push_back(join.make_completion());
+  join.release();
+
+  completions[1]();
+  assert(calls == 0);
+  completions.clear();
+  assert(calls == 1);
+};
+
+TEST(join_counter_no_allocations_per_completion)
+{
+  auto sum = 0;
+  join_counter<int> join(100, [&sum](join_results<int> results) {
+    for (auto& result : results)
+      sum += *result;
+  });
+
+  allocation_counter counter;
+  for (auto i = 0; i < 100; ++i)
+    {
+      call_once_silent<int> completion = join.make_completion();
+      completion(i);
+    }
+  join.release();
+  ASSERT_ALLOCATIONS(counter, 0);
+  assert(sum == 99 * 100 / 2);
+};
+
+TEST(join_counter_allocator)
+{
+  std::allocator<int> alloc;
+  auto called = false;
+  join_counter<std::unique_ptr<int>> join(
+      std::allocator_arg, alloc, 1,
+      [&called](join_results<std::unique_ptr<int>> results) {
+        called = **results[0] == 7;
+      });
+
+  join.make_completion()(std::make_unique<int>(7));
+  join.release();
+  assert(called);
+};
+
+TEST(join_counter_threads)
+{
+  constexpr auto threads = 8;
+  auto calls = 0;
+  auto sum = 0;
+
+  join_counter<int> join(threads, [&](join_results<int> results) {
+    ++calls;
+    for (auto& result : results)
+      sum += *result;
+  });
+
+  std::vector<std::thread> workers;
+  for (auto i = 0; i < threads; ++i)
+    workers.emplace_back(
+        [i, completion = join.make_completion()]() mutable { completion(i); });
+  join.release();
+
+  for (auto& worker : workers)
+    worker.join();
+
+  assert(calls == 1);
+  assert(sum == threads * (threads - 1) / 2);
+};
@@ -5,6 +5,7 @@
 // http://www.boost.org/LICENSE_1_0.txt)
 
 #include <memory>
+#include <vector>
 
 #include "ak/not_empty_function.hpp"
 
@@ -74,4 +75,148 @@ TEST(not_empty_function_example)
 
   FunctionStorage fs3([](int const& i) { return i - 2; });
   assert(fs3.invoke(5) == 3);
-};
\ No newline at end of file
+};
+
+TEST(not_empty_function_inline_capacity)
+{
+  struct big_capture
+  {
+    char data[128];
+  };
+
+  auto small = [i = 0](int a) { return a + i; };
+  auto large = [b = big_capture{}](int a) { return a + b.data[0]; };
+
+  static_assert(
+      not_empty_function<int(int)>::fits_inline<decltype(small)>, "");
+  static_assert(
+      !not_empty_function<int(int)>::fits_inline<decltype(large)>, "");
+  static_assert(
+      not_empty_function<int(int), 128>::fits_inline<decltype(large)>, "");
+  static_assert(sizeof(not_empty_function<int(int), 128>) > 128, "");
+
+  not_empty_function<int(int)> f1 = large;
+  not_empty_function<int(int), 128> f2 = large;
+  not_empty_function<int(int), 128> f3 = f2;
+
+  assert(f1(1) == 1);
+  assert(f2(2) == 2);
+  assert(f3(3) == 3);
+};
+
+TEST(not_empty_function_target_lifetime)
+{
+  auto counter = std::make_shared<int>(0);
+  {
+    not_empty_function<int()> f1 = [counter] { return ++*counter; };
+    assert(counter.use_count() == 2);
+
+    not_empty_function<int()> f2 = f1;
+    assert(counter.use_count() == 3);
+
+    f1 = [] { return 0; };
+    assert(counter.use_count() == 2);
+    assert(f2() == 1);
+
+    f1.swap(f2);
+    assert(f1() == 2);
+    assert(f2() == 0);
+  }
+  assert(counter.use_count() == 1);
+};
+
+TEST(not_empty_function_move)
+{
+  auto counter = std::make_shared<int>(0);
+
+  not_empty_function<int()> f1 = [counter] { return ++*counter; };
+  not_empty_function<int()> f2 = std::move(f1);
+  assert(counter.use_count() == 2);
+  assert(f2() == 1);
+  assert(f1 != nullptr);
+
+  std::vector<not_empty_function<int()>> functions;
+  for (auto i = 0; i < 100; ++i)
+    functions.push_back(f2);
+  assert(counter.use_count() == 102);
+
+  f1 = std::move(functions.back());
+  functions.pop_back();
+  assert(counter.use_count() == 102);
+  assert(functions.size() == 99);
+  assert(f1() == 2);
+};
+
+TEST(not_empty_function_allocations)
+{
+  struct big_capture
+  {
+    char data[128];
+  };
+
+  auto small = [a = 0L, b = 0L](int i) { return i + int(a + b); };
+  auto large = [b = big_capture{}](int i) { return i + b.data[0]; };
+  static_assert(sizeof(small) == 16, "");
+
+  allocation_counter counter;
+  not_empty_function<int(int)> f1 = small;
+  not_empty_function<int(int)> f2 = f1;
+  not_empty_function<int(int)> f3 = std::move(f1);
+  f2.swap(f3);
+  assert(f2(1) == 1);
+  ASSERT_ALLOCATIONS(counter, 0);
+
+  not_empty_function<int(int)> heap = large;
+  ASSERT_ALLOCATIONS(counter, 1);
+
+  not_empty_function<int(int), 128> inline_large = large;
+  not_empty_function<int(int), 128> inline_copy = inline_large;
+  ASSERT_ALLOCATIONS(counter, 1);
+};
+
+TEST(not_empty_function_stateless)
+{
+  auto const stateless = [](int i) { return i + 1; };
+  int (*pointer)(int) = +stateless;
+  static_assert(not_empty_function<int(int)>::fits_inline<decltype(stateless)>,
+                "");
+  static_assert(not_empty_function<int(int)>::fits_inline<decltype(pointer)>,
+                "");
+  using pointer_sized =
+      not_empty_function<int(int), sizeof(void*), alignof(void*)>;
+  static_assert(sizeof(pointer_sized) == 2 * sizeof(void*), "");
+
+  allocation_counter counter;
+  not_empty_function<int(int)> f1 = stateless;
+  pointer_sized f2 = pointer;
+  auto f3 = f1;
+  auto f4 = f2;
+  f1 = pointer;
+  assert(f1(1) == 2 && f2(2) == 3 && f3(3) == 4 && f4(4) == 5);
+  ASSERT_ALLOCATIONS(counter, 0);
+};
+
+namespace not_empty_function_test
+{
+
+struct member_target
+{
+  int get() const
+  {
+    return value;
+  }
+
+  int value;
+};
+
+} // namespace not_empty_function_test
+
+TEST(not_empty_function_member_pointers)
+{
+  using not_empty_function_test::member_target;
+
+  not_empty_function<int(member_target const&)> method = &member_target::get;
+  not_empty_function<int(member_target const&)> field = &member_target::value;
+  member_target const target{3};
+  assert(method(target) == 3 && field(target) == 3);
+};
@@ -0,0 +1,130 @@
+// Copyright (C) 2021 Artem Komyshan
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ak/call_once_silent.hpp"
+#include "ak/oneshot.hpp"
+
+#include "test.hpp"
+
+using namespace ak;
+
+TEST(oneshot_value_then_continuation)
+{
+  auto [sender, receiver] = oneshot<std::string>();
+  assert(sender && receiver && !receiver.ready());
+
+  sender("done");
+  assert(!sender);
+  assert(receiver.ready());
+
+  std::optional<std::string> result;
+  receiver.then([&result](std::optional<std::string> r) { result = r; });
+  assert(!receiver);
+  assert(result == std::string("done"));
+};
+
+TEST(oneshot_continuation_then_value)
+{
+  auto [sender, receiver] = oneshot<int>();
+
+  std::optional<int> result;
+  receiver.then([&result](std::optional<int> r) { result = r; });
+  assert(!result);
+
+  sender(42);
+  assert(result == 42);
+};
+
+TEST(oneshot_first_call_wins)
+{
+  auto [sender, receiver] = oneshot<int>();
+
+  sender(1);
+  sender(2);
+  assert(receiver.wait() == 1);
+};
+
+TEST(oneshot_broken)
+{
+  std::optional<int> result = 0;
+  {
+    auto [sender, receiver] = oneshot<int>();
+    receiver.then([&result](std::optional<int> r) { result = r; });
+  }
+  assert(!result);
+
+  oneshot<int> channel;
+  channel.sender = {};
+  assert(!channel.receiver.wait());
+};
+
+TEST(oneshot_dropped_receiver)
+{
+  auto [sender, receiver] = oneshot<std::unique_ptr<int>>();
+  receiver = {};
+  sender(std::make_unique<int>(1));
+};
+
+TEST(oneshot_as_callback)
+{
+  auto [sender, receiver] = oneshot<int>();
+
+  call_once_silent<int> callback = std::move(sender);
+  assert(!sender);
+  callback(7);
+  assert(receiver.wait() == 7);
+};
+
+TEST(oneshot_single_allocation)
+{
+  allocation_counter counter;
+  {
+    auto [sender, receiver] = oneshot<int>();
+    receiver.then([](std::optional<int> r) { assert(r == 3); });
+    call_once_silent<int> callback = std::move(sender);
+    callback(3);
+  }
+  ASSERT_ALLOCATIONS(counter, 1);
+};
+
+TEST(oneshot_wait_threads)
+{
+  for (auto i = 0; i < 100; ++i)
+    {
+      oneshot<int> channel;
+      auto& sender = channel.sender;
+      std::thread thread([&sender, i] { sender(i); });
+      assert(channel.receiver.wait() == i);
+      thread.join();
+    }
+};
+
+TEST(oneshot_concurrent_senders)
+{
+  for (auto i = 0; i < 100; ++i)
+    {
+      oneshot<int> channel;
+      auto& sender = channel.sender;
+      std::atomic<int> calls{0};
+      channel.receiver.then([&calls](std::optional<int> r) {
+        assert(r == 1 || r == 2);
+        ++calls;
+      });
+
+      std::thread response([&sender] { sender(1); });
+      std::thread timeout([&sender] { sender(2); });
+      response.join();
+      timeout.join();
+      assert(calls == 1);
+    }
+};
@@ -0,0 +1,154 @@
+// Copyright (C) 2021 Artem Komyshan
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+
+#include "ak/executor.hpp"
+#include "ak/pmr.hpp"
+
+#include "test.hpp"
+
+namespace
+{
+
+/// Forwards to the default resource and counts the blocks it holds.
+class counting_resource : public std::pmr::memory_resource
+{
+public:
+  std::size_t live = 0;
+  std::size_t total = 0;
+
+private:
+  void* do_allocate(std::size_t bytes, std::size_t align) override
+  {
+    ++live;
+    ++total;
+    return std::pmr::new_delete_resource()->allocate(bytes, align);
+  }
+
+  void do_deallocate(void* p, std::size_t bytes, std::size_t align) override
+  {
+    --live;
+    std::pmr::new_delete_resource()->deallocate(p, bytes, align);
+  }
+
+  bool do_is_equal(memory_resource const& o) const noexcept override
+  {
+    return this == &o;
+  }
+};
+
+} // namespace
+
+TEST(pmr_arena_serves_all_allocations)
+{
+  alignas(std::max_align_t) unsigned char buffer[4096];
+  std::pmr::monotonic_buffer_resource arena(buffer, sizeof(buffer),
+                                            std::pmr::null_memory_resource());
+  ak::pmr::allocator alloc(&arena);
+
+  std::array<char, 256> big{};
+  big[0] = 1;
+  auto called = 0;
+
+  allocation_counter counter;
+  {
+    ak::pmr::not_empty_function<int()> nef(
+        std::allocator_arg, alloc, [big] { return int(big[0]); });
+    auto copy = nef;
+    ak::pmr::shared_function<int()> sf(std::allocator_arg, alloc,
+                                       [big] { return int(big[0]); });
+    ak::pmr::local_shared_function<int()> lsf(std::allocator_arg, alloc,
+                                              [big] { return int(big[0]); });
+    ak::pmr::call_once_silent<> cos(std::allocator_arg, alloc,
+                                    [big, &called] { called += big[0]; });
+    ak::pmr::call_on_expire coe(std::allocator_arg, alloc,
+                                [big, &called] { called += big[0]; });
+
+    assert(nef() + copy() + sf() + lsf() == 4);
+    cos();
+    assert(called == 1);
+  }
+  ASSERT_ALLOCATIONS(counter, 0);
+  assert(called == 2);
+};
+
+TEST(pmr_blocks_are_returned)
+{
+  counting_resource resource;
+  ak::pmr::allocator alloc(&resource);
+  std::array<char, 128> big{};
+
+  {
+    ak::not_empty_function<void()> nef(std::allocator_arg, alloc, [big] {});
+    auto copy = nef;
+    assert(resource.live == 2);
+
+    ak::shared_function<void()> sf(std::allocator_arg, alloc, [big] {});
+    auto sf_copy = sf;
+    assert(resource.live == 3);
+
+    ak::call_once_silent<> cos(std::allocator_arg, alloc, [big] {});
+    cos();
+    assert(resource.live == 3);
+  }
+  assert(resource.live == 0);
+  assert(resource.total == 4);
+
+  // small targets stay inline and never touch the allocator
+  ak::not_empty_function<void()> small(std::allocator_arg, alloc, [] {});
+  small();
+  assert(resource.total == 4);
+};
+
+TEST(pmr_call_on_expire_executor)
+{
+  counting_resource resource;
+  auto called = 0;
+  ak::inline_executor executor;
+  {
+    ak::call_on_expire coe(std::allocator_arg, ak::pmr::allocator(&resource),
+                           executor, [&called] { ++called; });
+    auto copy = coe;
+    assert(resource.live == 1);
+  }
+  assert(called == 1);
+  assert(resource.live == 0);
+};
+
+TEST(pmr_default_resource)
+{
+  counting_resource resource;
+  auto const previous = std::pmr::set_default_resource(&resource);
+  std::array<char, 128> big{};
+  auto called = 0;
+
+  {
+    ak::pmr::not_empty_function<void()> nef = [big] {};
+    ak::pmr::shared_function<void()> sf = [big] {};
+    auto sf_copy = sf;
+    ak::pmr::call_once_silent<> cos = [big] {};
+    ak::pmr::concurrent_call_once_silent<> ccos = [big] {};
+    ak::pmr::call_on_expire coe = [big, &called] { called += 1 + big[0]; };
+    // call_on_expire keeps the big action apart from the shared block
+    assert(resource.live == 6);
+
+    sf = [big] {};
+    assert(resource.live == 7);
+
+    // a pmr wrapper is a plain wrapper, copies keep the resource
+    ak::shared_function<void()> plain = sf;
+    ak::call_on_expire plain_coe = coe;
+    assert(resource.live == 7);
+  }
+  std::pmr::set_default_resource(previous);
+
+  assert(called == 1);
+  assert(resource.live == 0);
+};
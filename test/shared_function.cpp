@@ -4,6 +4,10 @@
 // License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
 // http://www.boost.org/LICENSE_1_0.txt)
 
+#include <memory>
+#include <thread>
+#include <vector>
+
 #include "ak/shared_function.hpp"
 
 #include "test.hpp"
@@ -92,4 +96,206 @@ TEST(shared_function_shared)
   }
   
   assert(9 == vf(2, 1));
-};
\ No newline at end of file
+};
+
+TEST(shared_function_target_lifetime)
+{
+  auto counter = std::make_shared<int>(0);
+  shared_function<int()> vf = [counter] { return ++*counter; };
+  assert(counter.use_count() == 2);
+
+  {
+    auto copy = vf;
+    std::function<int()> func = vf.to_function();
+    assert(counter.use_count() == 2);
+    assert(1 == copy());
+    assert(2 == func());
+    vf = nullptr;
+  }
+
+  assert(counter.use_count() == 1);
+  assert(!vf.to_function());
+};
+
+TEST(local_shared_function_shared)
+{
+  auto counter = std::make_shared<int>(0);
+  local_shared_function<int(int)> vf;
+  assert(vf == nullptr);
+  {
+    local_shared_function<int(int)> vft = [counter](int a) {
+      return *counter += a;
+    };
+    vf = vft;
+
+    auto other = vft;
+    other.swap(vf);
+    assert(3 == vft(3));
+  }
+
+  assert(counter.use_count() == 2);
+  assert(5 == vf(2));
+
+  vf = nullptr;
+  assert(counter.use_count() == 1);
+};
+
+TEST(shared_function_allocations)
+{
+  allocation_counter counter;
+  shared_function<int(int)> vf = [n = 0](int a) { return a + n; };
+  ASSERT_ALLOCATIONS(counter, 1);
+
+  auto copy = vf;
+  auto moved = std::move(copy);
+  local_shared_function<int(int)> local = [n = 0](int a) { return a + n; };
+  auto local_copy = local;
+  assert(moved(1) == local_copy(1));
+  ASSERT_ALLOCATIONS(counter, 2);
+};
+
+namespace
+{
+
+int twice(int a)
+{
+  return 2 * a;
+}
+
+} // namespace
+
+TEST(shared_function_stateless)
+{
+  auto const increment = [](int a) { return a + 1; };
+  static_assert(sizeof(shared_function<int(int)>) == 2 * sizeof(void*), "");
+  static_assert(is_stateless_callable<decltype(increment)>::value, "");
+  static_assert(!is_stateless_callable<decltype(&twice)>::value, "");
+  static_assert(is_function_pointer<decltype(&twice)>::value, "");
+
+  allocation_counter counter;
+  shared_function<int(int)> lambda = increment;
+  shared_function<int(int)> pointer = &twice;
+  auto copy = lambda;
+  local_shared_function<int(int)> local = twice;
+  auto moved = std::move(pointer);
+  ASSERT_ALLOCATIONS(counter, 0);
+
+  assert(lambda(1) == 2 && copy(2) == 3);
+  assert(moved(3) == 6 && local(4) == 8);
+  assert(pointer == nullptr);
+
+  int (*null)(int) = nullptr;
+  shared_function<int(int)> empty = null;
+  assert(empty == nullptr);
+
+  moved.swap(copy);
+  assert(moved(1) == 2 && copy(1) == 2);
+  assert(moved.to_function()(5) == 6);
+};
+
+TEST(shared_function_discards_result)
+{
+  auto calls = 0;
+  shared_function<void(int)> capturing = [&calls](int a) {
+    ++calls;
+    return a;
+  };
+  shared_function<void(int)> lambda = [](int a) { return a; };
+  shared_function<void(int)> pointer = &twice;
+
+  capturing(1);
+  lambda(2);
+  pointer(3);
+  assert(calls == 1);
+};
+
+namespace shared_function_test
+{
+
+int seven()
+{
+  return 7;
+}
+
+/// Converts to a function pointer, but has state of its own.
+struct convertible
+{
+  using function_t = int (*)();
+
+  int operator()() const
+  {
+    return value;
+  }
+
+  operator function_t() const
+  {
+    return &seven;
+  }
+
+  int value = 42;
+};
+
+} // namespace shared_function_test
+
+TEST(shared_function_stateful_convertible)
+{
+  shared_function<int()> func = shared_function_test::convertible{};
+  assert(func() == 42);
+};
+
+TEST(biased_shared_function_owner)
+{
+  auto token = std::make_shared<int>(0);
+  {
+    biased_shared_function<int(int)> f = [token](int a) { return *token += a; };
+    auto copy = f;
+    std::vector<biased_shared_function<int(int)>> copies(10, copy);
+    assert(copies.back()(2) == 2);
+    assert(token.use_count() == 2);
+  }
+  assert(token.use_count() == 1);
+};
+
+TEST(biased_shared_function_other_threads)
+{
+  auto token = std::make_shared<int>(0);
+  {
+    biased_shared_function<int()> f = [token] { return *token; };
+
+    // copies counted by other threads
+    std::vector<std::thread> threads;
+    for (auto i = 0; i < 4; ++i)
+      threads.emplace_back([f] {
+        for (auto j = 0; j < 1000; ++j)
+          {
+            auto copy = f;
+            copy();
+          }
+      });
+    for (auto& t : threads)
+      t.join();
+
+    // copies counted by the owner and dropped by another thread
+    std::vector<biased_shared_function<int()>> copies(10, f);
+    std::thread([copies = std::move(copies)]() mutable {
+      copies.clear();
+    }).join();
+    assert(token.use_count() == 2);
+  }
+  assert(token.use_count() == 1);
+};
+
+TEST(biased_shared_function_owner_exits)
+{
+  auto token = std::make_shared<int>(0);
+  biased_shared_function<int()> kept;
+  std::thread([&kept, token] {
+    biased_shared_function<int()> f = [token] { return *token + 1; };
+    kept = f;
+  }).join();
+
+  assert(kept() == 1);
+  assert(token.use_count() == 2);
+  kept = nullptr;
+  assert(token.use_count() == 1);
+};
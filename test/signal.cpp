@@ -0,0 +1,180 @@
+// Copyright (C) 2021 Artem Komyshan
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <memory>
+#include <vector>
+
+#include "ak/callback_guardian.hpp"
+#include "ak/signal.hpp"
+
+#include "test.hpp"
+
+TEST(signal_emit_in_order)
+{
+  std::vector<int> calls;
+  ak::signal<void(int)> sig;
+  assert(sig.empty());
+
+  sig.connect([&calls](int v) { calls.push_back(v); });
+  sig.connect([&calls](int v) { calls.push_back(v * 10); });
+  assert(sig.size() == 2);
+
+  sig(3);
+  assert((calls == std::vector<int>{3, 30}));
+};
+
+TEST(signal_disconnect)
+{
+  auto a = 0;
+  auto b = 0;
+  ak::signal<void()> sig;
+  auto ca = sig.connect([&a] { ++a; });
+  auto cb = sig.connect([&b] { ++b; });
+
+  assert(sig.disconnect(ca));
+  assert(!sig.disconnect(ca));
+  assert(!sig.connected(ca));
+  assert(sig.connected(cb));
+  sig();
+  assert(a == 0 && b == 1);
+
+  // the id is reused, the stale handle stays disconnected
+  auto cc = sig.connect([&a] { ++a; });
+  assert(cc.id == ca.id);
+  assert(!sig.connected(ca));
+  assert(!sig.disconnect(ca));
+  sig();
+  assert(a == 1 && b == 2);
+
+  sig.disconnect_all();
+  assert(sig.empty());
+  sig();
+  assert(a == 1 && b == 2);
+};
+
+TEST(signal_disconnect_during_emit)
+{
+  ak::signal<void()> sig;
+  std::vector<int> calls;
+  ak::signal<void()>::connection self;
+  ak::signal<void()>::connection next;
+
+  auto token = std::make_shared<int>(7);
+  self = sig.connect([&, token] {
+    calls.push_back(*token);
+    sig.disconnect(self);
+    sig.disconnect(next);
+    // the running handler is still alive
+    calls.push_back(*token);
+  });
+  next = sig.connect([&calls] { calls.push_back(2); });
+  sig.connect([&calls] { calls.push_back(3); });
+
+  sig();
+  assert((calls == std::vector<int>{7, 7, 3}));
+  assert(sig.size() == 1);
+  assert(token.use_count() == 1);
+};
+
+TEST(signal_connect_during_emit)
+{
+  ak::signal<void()> sig;
+  auto added = 0;
+  auto calls = 0;
+  ak::signal<void()>::connection late;
+
+  sig.connect([&] {
+    ++calls;
+    if (added++ == 0)
+      {
+        late = sig.connect([&calls] { calls += 100; });
+        // a handler connected during emit may be disconnected right away
+        auto gone = sig.connect([&calls] { calls += 1000; });
+        sig.disconnect(gone);
+      }
+  });
+
+  sig();
+  assert(calls == 1);
+  assert(sig.connected(late));
+  assert(sig.size() == 2);
+
+  sig();
+  assert(calls == 102);
+};
+
+TEST(signal_nested_emit)
+{
+  ak::signal<void(int)> sig;
+  std::vector<int> calls;
+  sig.connect([&](int depth) {
+    calls.push_back(depth);
+    if (depth == 0)
+      sig(1);
+  });
+  sig.connect([&](int depth) { calls.push_back(depth + 10); });
+
+  sig(0);
+  assert((calls == std::vector<int>{0, 1, 11, 10}));
+};
+
+TEST(signal_guardian)
+{
+  ak::signal<void()> sig;
+  auto calls = 0;
+  ak::signal<void()>::connection c;
+  {
+    ak::callback_guardian owner;
+    c = sig.connect(owner, [&calls] { ++calls; });
+    sig();
+    assert(calls == 1);
+  }
+  assert(sig.connected(c));
+  sig();
+  assert(calls == 1);
+  assert(!sig.connected(c));
+  assert(sig.empty());
+
+  ak::callback_guardian owner;
+  sig.connect(owner, [&calls] { ++calls; });
+  owner.invalidate_all();
+  sig();
+  assert(calls == 1);
+  assert(sig.empty());
+};
+
+TEST(signal_inline_handlers)
+{
+  ak::signal<void()> sig;
+  sig.reserve(3);
+
+  allocation_counter counter;
+  auto value = 0;
+  auto const first = sig.connect([] {});
+  sig.connect([] {});
+  for (auto i = 0; i < 100; ++i)
+    sig();
+  sig.connect([&value] { ++value; });
+  sig.disconnect(first);
+  sig();
+  assert(value == 1);
+  // the handlers are stored inline
+  ASSERT_ALLOCATIONS(counter, 0);
+};
+
+TEST(signal_disconnect_destroys_handler)
+{
+  ak::signal<void()> sig;
+  auto token = std::make_shared<int>(0);
+  auto first = sig.connect([token] {});
+  sig.connect([] {});
+  sig.connect([] {});
+
+  // far below the compaction threshold, the captures go away anyway
+  assert(sig.disconnect(first));
+  assert(token.use_count() == 1);
+  sig();
+};
@@ -0,0 +1,116 @@
+// Copyright (C) 2021 Artem Komyshan
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "ak/call_on_expire.hpp"
+#include "ak/task_queue.hpp"
+
+#include "test.hpp"
+
+TEST(task_queue_fifo)
+{
+  ak::task_queue queue;
+  assert(queue.empty());
+  assert(queue.drain() == 0);
+
+  std::vector<int> order;
+  for (auto i = 0; i < 5; ++i)
+    queue.post([&order, i] { order.push_back(i); });
+  assert(!queue.empty());
+
+  assert(queue.drain(2) == 2);
+  assert((order == std::vector<int>{0, 1}));
+
+  ak::call_once_silent<> task;
+  assert(queue.try_pop(task));
+  task();
+  assert(queue.drain() == 2);
+  assert((order == std::vector<int>{0, 1, 2, 3, 4}));
+  assert(queue.empty());
+};
+
+TEST(task_queue_move_only)
+{
+  ak::task_queue queue;
+  auto value = std::make_unique<int>(7);
+  auto result = 0;
+  queue.post([&result, v = std::move(value)] { result = *v; });
+  queue.drain();
+  assert(result == 7);
+};
+
+TEST(task_queue_post_from_task)
+{
+  ak::task_queue queue;
+  auto calls = 0;
+  queue.post([&] {
+    ++calls;
+    queue.post([&calls] { ++calls; });
+  });
+
+  assert(queue.drain() == 2);
+  assert(calls == 2);
+};
+
+TEST(task_queue_destroys_pending)
+{
+  auto token = std::make_shared<int>(0);
+  {
+    ak::task_queue queue;
+    queue.post([token] { ++*token; });
+    queue.post([token] { ++*token; });
+    assert(token.use_count() == 3);
+  }
+  assert(token.use_count() == 1);
+  assert(*token == 0);
+};
+
+TEST(task_queue_executor)
+{
+  ak::task_queue queue;
+  auto called = 0;
+  {
+    ak::call_on_expire coe(queue, [&called] { ++called; });
+  }
+  assert(called == 0);
+  queue.drain();
+  assert(called == 1);
+};
+
+TEST(task_queue_producers)
+{
+  constexpr auto producers = 4;
+  constexpr auto per_producer = 10000;
+
+  ak::task_queue queue;
+  std::vector<int> last(producers, -1);
+  auto in_order = true;
+
+  std::vector<std::thread> threads;
+  for (auto p = 0; p < producers; ++p)
+    threads.emplace_back([&, p] {
+      for (auto i = 0; i < per_producer; ++i)
+        queue.post([&, p, i] {
+          in_order = in_order && last[p] == i - 1;
+          last[p] = i;
+        });
+    });
+
+  std::size_t done = 0;
+  while (done < producers * per_producer)
+    done += queue.drain();
+
+  for (auto& t : threads)
+    t.join();
+
+  assert(in_order);
+  for (auto l : last)
+    assert(l == per_producer - 1);
+  assert(queue.empty());
+};
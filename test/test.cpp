@@ -8,11 +8,23 @@
 
 #include <iostream>
 
+#include "atomic_shared_function.cpp"
+#include "awaitable.cpp"
 #include "call_on_expire.cpp"
 #include "call_once_silent.cpp"
+#include "call_once_strict.cpp"
+#include "callback_arena.cpp"
+#include "callback_collection.cpp"
 #include "callback_guardian.cpp"
+#include "function_ref.cpp"
+#include "join_counter.cpp"
 #include "not_empty_function.cpp"
+#include "oneshot.cpp"
+#include "pmr.cpp"
 #include "shared_function.cpp"
+#include "signal.cpp"
+#include "task_queue.cpp"
+#include "thread_pool.cpp"
 
 int main()
 {
@@ -22,7 +34,13 @@ int main()
     {
       std::cout << count << " " << test.first << std::endl;
       ++count;
+
+      allocation_counter counter;
       test.second();
+#ifdef AK_TEST_COUNT_ALLOCATIONS
+      std::cout << "  allocations: " << counter.allocations()
+                << ", deallocations: " << counter.deallocations() << std::endl;
+#endif
     }
 
   return 0;
@@ -6,10 +6,14 @@
 
 #pragma once
 
+#include <atomic>
 #include <cassert>
+#include <cstddef>
+#include <cstdlib>
 #include <functional>
 #include <iostream>
 #include <string>
+#include <new>
 #include <unordered_map>
 
 std::unordered_map<std::string, std::function<void()>> tests;
@@ -31,4 +35,136 @@ struct test_t
 #define STRINGIFY_(x) #x
 #define STRINGIFY(x) STRINGIFY_(x)
 
-#define TEST(NAME) auto NAME = test_t{STRINGIFY(NAME)} << []
\ No newline at end of file
+#define TEST(NAME) auto NAME = test_t{STRINGIFY(NAME)} << []
+
+/**
+ * Allocation counting mode, enabled by AK_TEST_COUNT_ALLOCATIONS. The global
+ * operator new and delete are replaced to count calls made by any thread, so
+ * tests can assert the allocation guarantees of the wrappers:
+ *
+ *   allocation_counter counter;
+ *   not_empty_function<void()> f = [] {};
+ *   ASSERT_ALLOCATIONS(counter, 0);
+ *
+ * Without the mode ASSERT_ALLOCATIONS checks nothing.
+ */
+
+std::atomic<std::size_t> allocation_count{0};
+std::atomic<std::size_t> deallocation_count{0};
+
+struct allocation_counter
+{
+  std::size_t allocations() const
+  {
+    return allocation_count - start_allocations;
+  }
+
+  std::size_t deallocations() const
+  {
+    return deallocation_count - start_deallocations;
+  }
+
+  std::size_t start_allocations = allocation_count;
+  std::size_t start_deallocations = deallocation_count;
+};
+
+#ifdef AK_TEST_COUNT_ALLOCATIONS
+
+#define ASSERT_ALLOCATIONS(COUNTER, N) assert((COUNTER).allocations() == (N))
+
+namespace test_detail
+{
+
+inline void* allocate(std::size_t size)
+{
+  ++allocation_count;
+  if (auto p = std::malloc(size ? size : 1))
+    return p;
+  throw std::bad_alloc();
+}
+
+inline void* allocate(std::size_t size, std::align_val_t align)
+{
+  ++allocation_count;
+  auto const alignment = static_cast<std::size_t>(align);
+  auto const rounded = (size + alignment - 1) / alignment * alignment;
+  if (auto p = std::aligned_alloc(alignment, rounded ? rounded : alignment))
+    return p;
+  throw std::bad_alloc();
+}
+
+inline void deallocate(void* p) noexcept
+{
+  if (!p)
+    return;
+  ++deallocation_count;
+  std::free(p);
+}
+
+} // namespace test_detail
+
+void* operator new(std::size_t size)
+{
+  return test_detail::allocate(size);
+}
+
+void* operator new[](std::size_t size)
+{
+  return test_detail::allocate(size);
+}
+
+void* operator new(std::size_t size, std::align_val_t align)
+{
+  return test_detail::allocate(size, align);
+}
+
+void* operator new[](std::size_t size, std::align_val_t align)
+{
+  return test_detail::allocate(size, align);
+}
+
+void operator delete(void* p) noexcept
+{
+  test_detail::deallocate(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+  test_detail::deallocate(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+  test_detail::deallocate(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept
+{
+  test_detail::deallocate(p);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept
+{
+  test_detail::deallocate(p);
+}
+
+void operator delete[](void* p, std::align_val_t) noexcept
+{
+  test_detail::deallocate(p);
+}
+
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept
+{
+  test_detail::deallocate(p);
+}
+
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept
+{
+  test_detail::deallocate(p);
+}
+
+#else
+
+#define ASSERT_ALLOCATIONS(COUNTER, N) ((void)(COUNTER))
+
+#endif
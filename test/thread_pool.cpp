@@ -0,0 +1,128 @@
+// Copyright (C) 2021 Artem Komyshan
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+
+#include "ak/call_on_expire.hpp"
+#include "ak/callback_guardian.hpp"
+#include "ak/shared_function.hpp"
+#include "ak/task_queue.hpp"
+#include "ak/thread_pool.hpp"
+
+#include "test.hpp"
+
+TEST(thread_pool_post)
+{
+  std::atomic<int> calls{0};
+  {
+    ak::thread_pool pool(3);
+    assert(pool.size() == 3);
+    assert(!pool.running_in_this_thread());
+
+    for (auto i = 0; i < 1000; ++i)
+      pool.post([&calls] { ++calls; });
+
+    ak::call_once_silent<> once([&calls] { ++calls; });
+    pool.post(std::move(once));
+    ak::shared_function<void()> shared([&calls] { ++calls; });
+    pool.post(shared);
+    pool.post([&calls, v = std::make_unique<int>(1)] { calls += *v; });
+  }
+  assert(calls == 1003);
+};
+
+TEST(thread_pool_dispatch)
+{
+  ak::thread_pool pool(2);
+  std::atomic<bool> inline_run{false};
+  std::atomic<bool> done{false};
+
+  pool.post([&] {
+    auto ran = false;
+    pool.dispatch([&ran] { ran = true; });
+    inline_run = ran;
+    done = true;
+  });
+
+  while (!done)
+    std::this_thread::yield();
+  assert(inline_run);
+};
+
+TEST(thread_pool_defer_is_stolen)
+{
+  ak::thread_pool pool(2);
+  std::atomic<bool> deferred_ran{false};
+  std::atomic<bool> done{false};
+
+  pool.post([&] {
+    // the task stays in the queue of this worker, which is busy until the
+    // other worker steals it
+    pool.defer([&deferred_ran] { deferred_ran = true; });
+    auto const stop =
+        std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (!deferred_ran && std::chrono::steady_clock::now() < stop)
+      std::this_thread::yield();
+    done = true;
+  });
+
+  while (!done)
+    std::this_thread::yield();
+  assert(deferred_ran);
+};
+
+TEST(thread_pool_nested_post)
+{
+  std::atomic<int> calls{0};
+  {
+    ak::thread_pool pool(2);
+    for (auto i = 0; i < 100; ++i)
+      pool.post([&] {
+        ++calls;
+        pool.post([&calls] { ++calls; });
+        pool.defer([&calls] { ++calls; });
+      });
+  }
+  assert(calls == 300);
+};
+
+TEST(thread_pool_executor_overloads)
+{
+  std::atomic<int> calls{0};
+  std::atomic<int> errors{0};
+  {
+    // the owners outlive the pool, which runs the posted calls on exit
+    ak::callback_guardian guardian;
+    ak::concurrent_callback_guardian concurrent;
+    ak::thread_pool pool(2);
+    {
+      ak::call_on_expire coe(pool, [&calls] { ++calls; });
+    }
+
+    auto cb = guardian.make_guarded_callback(
+        pool, [&calls](int v) { calls += v; }, [&errors] { ++errors; });
+    cb(10);
+
+    auto ccb = concurrent.make_guarded_callback(
+        pool, [&calls](int v) { calls += v; });
+    ccb(100);
+  }
+  assert(calls == 111);
+  assert(errors == 0);
+
+  ak::task_queue queue;
+  auto guardian = std::make_unique<ak::callback_guardian>();
+  auto cb = guardian->make_guarded_callback(
+      queue, [&calls] { ++calls; }, [&errors] { ++errors; });
+  cb();
+  guardian.reset();
+  queue.drain();
+  assert(calls == 111);
+  assert(errors == 1);
+};